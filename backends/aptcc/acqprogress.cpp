@@ -103,9 +103,11 @@ void AcqPackageKitStatus::Fail(pkgAcquire::ItemDesc &Itm)
 void AcqPackageKitStatus::Stop()
 {
 	pkgAcquireStatus::Stop();
-	// the items that still on the set are finished
-	for (set<string>::iterator it = currentPackages.begin();
-	     it != currentPackages.end();
+	// the items that still on the set are finished, emit_package()
+	// removes them so walk a copy
+	set<string> localCurrentPackages = currentPackages;
+	for (set<string>::iterator it = localCurrentPackages.begin();
+	     it != localCurrentPackages.end();
 	     it++ )
 	{
 		emit_package(*it, true);
@@ -136,7 +138,9 @@ bool AcqPackageKitStatus::Pulse(pkgAcquire *Owner)
 		last_percent = percent_done;
 	}
 
-	set<string> localCurrentPackages = currentPackages;;
+	set<string> localCurrentPackages = currentPackages;
+	double activeSize = 0;
+	double activeTotal = 0;
 	for (pkgAcquire::Worker *I = Owner->WorkersBegin(); I != 0;
 		I = Owner->WorkerStep(I))
 	{
@@ -151,18 +155,24 @@ bool AcqPackageKitStatus::Pulse(pkgAcquire *Owner)
 		// Add the total size and percent
 		if (I->TotalSize > 0 && I->CurrentItem->Owner->Complete == false)
 		{
-			unsigned long sub_percent;
-			// TODO PackageKit needs to emit package with progress.
-			sub_percent = long(double(I->CurrentSize*100.0)/double(I->TotalSize));
-			if (last_sub_percent != sub_percent) {
-				if (last_sub_percent < sub_percent) {
-					pk_backend_set_sub_percentage(m_backend, sub_percent);
-				} else {
-					pk_backend_set_sub_percentage(m_backend, PK_BACKEND_PERCENTAGE_INVALID);
-					pk_backend_set_sub_percentage(m_backend, sub_percent);
-				}
-				last_sub_percent = sub_percent;
+			activeSize += I->CurrentSize;
+			activeTotal += I->TotalSize;
+		}
+	}
+
+	// several items are downloaded at the same time, so the sub
+	// percentage is for all of them rather than the last worker
+	if (activeTotal > 0) {
+		unsigned long sub_percent;
+		sub_percent = long(activeSize * 100.0 / activeTotal);
+		if (last_sub_percent != sub_percent) {
+			if (last_sub_percent < sub_percent) {
+				pk_backend_set_sub_percentage(m_backend, sub_percent);
+			} else {
+				pk_backend_set_sub_percentage(m_backend, PK_BACKEND_PERCENTAGE_INVALID);
+				pk_backend_set_sub_percentage(m_backend, sub_percent);
 			}
+			last_sub_percent = sub_percent;
 		}
 	}
 
@@ -216,35 +226,34 @@ bool AcqPackageKitStatus::MediaChange(string Media, string Drive)
 
 void AcqPackageKitStatus::addPackagePair(pair<pkgCache::PkgIterator, pkgCache::VerIterator> packagePair)
 {
-	packages.push_back(packagePair);
+	packages[packagePair.first.Name()] = packagePair;
 }
 
 void AcqPackageKitStatus::emit_package(const string &name, bool finished)
 {
-	if (name.compare(last_package_name) != 0 && packages.size()) {
-		// find the package
-		for (vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::iterator it = packages.begin();
-			    it != packages.end(); ++it)
-		{
-			if (_cancelled) {
-				break;
-			}
-			// try to see if any package matches
-			if (name.compare(it->first.Name()) == 0) {
-				m_apt->emit_package(it->first,
-						    it->second,
-						    PK_INFO_ENUM_UNKNOWN,
-							finished ? PK_INFO_ENUM_FINISHED : PK_INFO_ENUM_DOWNLOADING);
-				last_package_name = name;
-
-				// Find the downloading item
-				if (finished) {
-					currentPackages.erase(name);
-				} else {
-					currentPackages.insert(name);
-				}
-				break;
-			}
+	if (_cancelled) {
+		return;
+	}
+
+	// try to see if any package matches
+	map<string, pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::iterator it;
+	it = packages.find(name);
+	if (it == packages.end()) {
+		return;
+	}
+
+	// only emit when the state of the item changes, the items
+	// downloading at the same time are seen in turns
+	if (finished) {
+		if (currentPackages.erase(name) == 0) {
+			return;
 		}
+	} else if (currentPackages.insert(name).second == false) {
+		return;
 	}
+
+	m_apt->emit_package(it->second.first,
+			    it->second.second,
+			    PK_INFO_ENUM_UNKNOWN,
+			    finished ? PK_INFO_ENUM_FINISHED : PK_INFO_ENUM_DOWNLOADING);
 }
@@ -13,6 +13,8 @@
 #include <apt-pkg/acquire.h>
 #include <pk-backend.h>
 
+#include <map>
+
 #include "apt.h"
 
 class AcqPackageKitStatus : public pkgAcquireStatus
@@ -40,10 +42,10 @@ private:
 	unsigned long last_percent;
 	unsigned long last_sub_percent;
 	double        last_CPS;
-	string        last_package_name;
 	aptcc         *m_apt;
 
-	vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > packages;
+	// the packages being fetched, by name
+	map<string, pair<pkgCache::PkgIterator, pkgCache::VerIterator> > packages;
 	set<string> currentPackages;
 
 	void emit_package(const string &name, bool finished);
@@ -22,9 +22,14 @@
 #include "apt-utils.h"
 
 #include "pkg_acqfile.h"
+
+#include <apt-pkg/fileutl.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <map>
 #include <sys/stat.h>
+#include <unistd.h>
 
 static int descrBufferSize = 4096;
 static char *descrBuffer = new char[descrBufferSize];
@@ -244,47 +249,123 @@ get_enum_group (string group)
 	}
 }
 
-string getChangelogFile(const string &name,
-                        const string &origin,
-                        const string &verstr,
-                        const string &srcPkg,
+string getChangelogCacheFile(const string &srcPkg, const string &verstr)
+{
+    // a source version always has the same changelog, so it never needs
+    // to be downloaded again
+    return string(APTCC_CHANGELOG_CACHE_DIR) + "/" + srcPkg + "_" + verstr;
+}
+
+bool queueChangelogFile(const string &name,
                         const string &uri,
+                        const string &filename,
                         pkgAcquire *fetcher)
 {
-   string descr("Changelog for ");
-   descr += name;
-
-   // no need to translate this, the changelog is in english anyway
-   string filename = "/tmp/aptcc_changelog";
-
-   new pkgAcqFileSane(fetcher, uri, descr, name, filename);
-
-   ofstream out(filename.c_str());
-   if(fetcher->Run() == pkgAcquire::Failed) {
-      out << "Failed to download the list of changes. " << endl;
-      out << "Please check your Internet connection." << endl;
-      // FIXME: Need to dequeue the item
-   } else {
-        struct stat filestatus;
-        stat(filename.c_str(), &filestatus );
-
-        if (filestatus.st_size == 0) {
-            // FIXME: Use supportedOrigins
-            if (origin.compare("Ubuntu") == 0) {
-                out << "The list of changes is not available yet.\n" << endl;
-                out << "Please use http://launchpad.net/ubuntu/+source/"<< srcPkg <<
-                        "/" << verstr << "/+changelog" << endl;
-                out << "until the changes become available or try again later." << endl;
-            } else {
-                out << "This change is not coming from a source that supports changelogs.\n" << endl;
-                out << "Failed to fetch the changelog for " << name << endl;
-                out << "URI was: " << uri << endl;
-            }
+    struct stat filestatus;
+
+    // already cached
+    if (stat(filename.c_str(), &filestatus) == 0 && filestatus.st_size > 0) {
+        return false;
+    }
+
+    if (g_mkdir_with_parents(APTCC_CHANGELOG_CACHE_DIR, 0755) != 0) {
+        g_warning("failed to create %s", APTCC_CHANGELOG_CACHE_DIR);
+        return false;
+    }
+
+    string descr("Changelog for ");
+    descr += name;
+
+    // the fetcher owns the item
+    new pkgAcqFileSane(fetcher, uri, descr, name, filename);
+    return true;
+}
+
+void pruneChangelogCache(pkgCacheFile &Cache)
+{
+    GDir *dir = g_dir_open(APTCC_CHANGELOG_CACHE_DIR, 0, NULL);
+    if (dir == NULL) {
+        return;
+    }
+
+    // the cached files are named source_version
+    multimap<string, string> cached;
+    const gchar *name;
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        string file(name);
+        size_t sep = file.find('_');
+        if (sep == string::npos) {
+            continue;
+        }
+        cached.insert(make_pair(file.substr(sep + 1), file));
+    }
+    g_dir_close(dir);
+    if (cached.empty()) {
+        return;
+    }
+
+    // only the candidates with a cached version need their source looked up
+    set<string> keep;
+    pkgRecords records(Cache);
+    for (pkgCache::PkgIterator pkg = Cache->PkgBegin(); !pkg.end(); ++pkg) {
+        pkgCache::VerIterator candver = Cache[pkg].CandidateVerIter(Cache);
+        if (candver.end() || candver.FileList().end() || candver.VerStr() == NULL) {
+            continue;
+        }
+
+        string verstr = candver.VerStr();
+        if (verstr.find(':') != verstr.npos) {
+            verstr = string(verstr, verstr.find(':') + 1);
+        }
+        if (cached.find(verstr) == cached.end()) {
+            continue;
+        }
+
+        pkgRecords::Parser &rec = records.Lookup(candver.FileList());
+        string srcpkg = rec.SourcePkg().empty() ? string(pkg.Name()) : rec.SourcePkg();
+        keep.insert(srcpkg + "_" + verstr);
+    }
+
+    for (multimap<string, string>::iterator it = cached.begin(); it != cached.end(); ++it) {
+        if (keep.find(it->second) == keep.end()) {
+            unlink((string(APTCC_CHANGELOG_CACHE_DIR) + "/" + it->second).c_str());
+        }
+    }
+}
+
+string getChangelog(const string &name,
+                    const string &origin,
+                    const string &verstr,
+                    const string &srcPkg,
+                    const string &uri,
+                    const string &filename)
+{
+    ifstream in(filename.c_str());
+    stringstream out;
+
+    if (in) {
+        out << in.rdbuf();
+        if (out.tellp() > 0) {
+            return out.str();
         }
-   }
-   out.close();
+    }
 
-   return filename;
+    // no need to translate this, the changelog is in english anyway
+    if (!FileExists(filename)) {
+        out << "Failed to download the list of changes. " << endl;
+        out << "Please check your Internet connection." << endl;
+    } else if (origin.compare("Ubuntu") == 0) {
+        // FIXME: Use supportedOrigins
+        out << "The list of changes is not available yet.\n" << endl;
+        out << "Please use http://launchpad.net/ubuntu/+source/"<< srcPkg <<
+                "/" << verstr << "/+changelog" << endl;
+        out << "until the changes become available or try again later." << endl;
+    } else {
+        out << "This change is not coming from a source that supports changelogs.\n" << endl;
+        out << "Failed to fetch the changelog for " << name << endl;
+        out << "URI was: " << uri << endl;
+    }
+    return out.str();
 }
 
 string getCVEUrls(const string &changelog)
@@ -381,10 +462,10 @@ string getBugzillaUrls(const string &changelog)
     return ret;
 }
 
-bool contains(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > packages,
-	    const pkgCache::PkgIterator pkg)
+bool contains(const vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &packages,
+	    const pkgCache::PkgIterator &pkg)
 {
-	for(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::iterator it = packages.begin();
+	for(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::const_iterator it = packages.begin();
 	    it != packages.end(); ++it)
 	{
 		if (it->first == pkg) {
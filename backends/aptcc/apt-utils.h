@@ -36,6 +36,8 @@ typedef std::vector<pkgCache::PkgIterator> pkgvector;
 
 using namespace std;
 
+#define APTCC_CHANGELOG_CACHE_DIR	"/var/cache/PackageKit/aptcc-changelogs"
+
 // compare...uses the candidate version of each package.
 class compare
 {
@@ -104,15 +106,36 @@ string get_long_description_parsed(const pkgCache::VerIterator &ver,
 PkGroupEnum get_enum_group(string group);
 
 /**
-  * Return the changelog filename fetched
+  * Return the file the changelog of a source package version is cached in
   */
-string getChangelogFile(const string &name,
-                        const string &origin,
-                        const string &verstr,
-                        const string &srcPkg,
+string getChangelogCacheFile(const string &srcPkg, const string &verstr);
+
+/**
+  * Queue the changelog download on the fetcher, returns false if it
+  * is already in the cache
+  */
+bool queueChangelogFile(const string &name,
                         const string &uri,
+                        const string &filename,
                         pkgAcquire *fetcher);
 
+/**
+  * Remove the cached changelogs of versions that are no longer
+  * candidates in the package cache
+  */
+void pruneChangelogCache(pkgCacheFile &Cache);
+
+/**
+  * Return the cached changelog, or some text explaining why
+  * it could not be fetched
+  */
+string getChangelog(const string &name,
+                    const string &origin,
+                    const string &verstr,
+                    const string &srcPkg,
+                    const string &uri,
+                    const string &filename);
+
 /**
   * Returns a list of links pairs url;description for CVEs
   */
@@ -126,8 +149,8 @@ string getBugzillaUrls(const string &changelog);
 /**
   * Return if the given vector contain a package
   */
-bool contains(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > packages,
-	      const pkgCache::PkgIterator pkg);
+bool contains(const vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &packages,
+	      const pkgCache::PkgIterator &pkg);
 
 /**
   * Return if the given string ends with the other
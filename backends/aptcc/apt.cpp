@@ -35,6 +35,7 @@
 #include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/version.h>
 
+#include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <sys/statfs.h>
 #include <sys/wait.h>
@@ -43,8 +44,10 @@
 #define RAMFS_MAGIC     0x858458f6
 
 #include <fstream>
+#include <sstream>
 #include <dirent.h>
 #include <assert.h>
+#include <unistd.h>
 
 // Gstreamer stuff
 // #include <gst/gst.h>
@@ -60,7 +63,8 @@ aptcc::aptcc(PkBackend *backend, bool &cancel)
 	m_backend(backend),
 	_cancel(cancel),
 	m_terminalTimeout(120),
-	m_lastSubProgress(0)
+	m_lastSubProgress(0),
+	m_verFiltersSynced(false)
 {
 	_cancel = false;
 }
@@ -99,6 +103,12 @@ bool aptcc::init()
 		_config->Set("Acquire::ftp::Proxy", "");
 	}
 
+	// fetch from every mirror at the same time and keep several
+	// requests in flight on each connection, unless the admin
+	// configured it otherwise
+	_config->CndSet("Acquire::Queue-Mode", "host");
+	_config->CndSet("Acquire::http::Pipeline-Depth", "10");
+
 	packageSourceList = new pkgSourceList;
 	// Read the source list
 	packageSourceList->ReadMainList();
@@ -252,6 +262,95 @@ pkgCache::VerIterator aptcc::find_ver(const pkgCache::PkgIterator &pkg)
 	return pkg.VersionList();
 }
 
+// the filter properties a version has, the bits are the PkFilterEnum
+// values the version matches; NOT_FREE and COLLECTIONS are set for
+// contrib/non-free and metapackages
+static PkBitfield
+get_version_filters(const pkgCache::VerIterator &ver)
+{
+	PkBitfield props = 0;
+	const char *name = ver.ParentPkg().Name();
+	string str = ver.Section() == NULL ? "" : ver.Section();
+	string section, repo_section;
+
+	size_t found;
+	found = str.find_last_of("/");
+	section = str.substr(found + 1);
+	repo_section = str.substr(0, found);
+
+	if (g_str_has_suffix(name, "-dev") ||
+	    g_str_has_suffix(name, "-dbg") ||
+	    !section.compare("devel") ||
+	    !section.compare("libdevel")) {
+		pk_bitfield_add(props, PK_FILTER_ENUM_DEVELOPMENT);
+	}
+
+	if (!section.compare("x11") || !section.compare("gnome") ||
+	    !section.compare("kde") || !section.compare("graphics")) {
+		pk_bitfield_add(props, PK_FILTER_ENUM_GUI);
+	}
+
+	// TODO add Ubuntu handling
+	if (!repo_section.compare("contrib") ||
+	    !repo_section.compare("non-free")) {
+		pk_bitfield_add(props, PK_FILTER_ENUM_NOT_FREE);
+	}
+
+	if (!repo_section.compare("metapackages")) {
+		pk_bitfield_add(props, PK_FILTER_ENUM_COLLECTIONS);
+	}
+	return props;
+}
+
+// set on the entries of the table that have been computed
+#define APTCC_VER_FILTERS_KNOWN ((PkBitfield) 1 << 63)
+
+// the filter properties of the versions seen so far, indexed by version
+// ID; this is kept between transactions as long as the cache file is the
+// same, so the IDs still refer to the same versions
+static vector<PkBitfield> _verFilters;
+static time_t _verFiltersMtime = 0;
+static unsigned long _verFiltersCount = 0;
+
+void aptcc::syncVersionFilters()
+{
+	struct stat st;
+	string cacheFile = _config->FindFile("Dir::Cache::pkgcache");
+	unsigned long count = packageCache->HeaderP->VersionCount;
+
+	m_verFiltersSynced = true;
+
+	// a cache that is only in memory can't be told apart from the last one
+	if (cacheFile.empty() || stat(cacheFile.c_str(), &st) != 0) {
+		_verFilters.assign(count, 0);
+		_verFiltersMtime = 0;
+		_verFiltersCount = count;
+		return;
+	}
+
+	if (st.st_mtime == _verFiltersMtime && count == _verFiltersCount) {
+		return;
+	}
+
+	// the cache was rebuilt, so forget everything we know
+	_verFilters.assign(count, 0);
+	_verFiltersMtime = st.st_mtime;
+	_verFiltersCount = count;
+}
+
+PkBitfield aptcc::getVersionFilters(const pkgCache::VerIterator &ver)
+{
+	if (!m_verFiltersSynced) {
+		syncVersionFilters();
+	}
+
+	PkBitfield &props = _verFilters[ver->ID];
+	if ((props & APTCC_VER_FILTERS_KNOWN) == 0) {
+		props = get_version_filters(ver) | APTCC_VER_FILTERS_KNOWN;
+	}
+	return props;
+}
+
 // used to emit packages it collects all the needed info
 void aptcc::emit_package(const pkgCache::PkgIterator &pkg,
 			 const pkgCache::VerIterator &ver,
@@ -268,14 +367,6 @@ void aptcc::emit_package(const pkgCache::PkgIterator &pkg,
 	}
 
 	if (filters != 0) {
-		std::string str = ver.Section();
-		std::string section, repo_section;
-
-		size_t found;
-		found = str.find_last_of("/");
-		section = str.substr(found + 1);
-		repo_section = str.substr(0, found);
-
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED)
 		    && state == PK_INFO_ENUM_INSTALLED) {
 			return;
@@ -284,64 +375,39 @@ void aptcc::emit_package(const pkgCache::PkgIterator &pkg,
 			return;
 		}
 
+		// the properties this version must and must not have
+		PkBitfield want = 0;
+		PkBitfield reject = 0;
+
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_DEVELOPMENT)) {
-			// if ver.end() means unknow
-			// strcmp will be true when it's different than devel
-			std::string pkgName = pkg.Name();
-			if (!ends_with(pkgName, "-dev") &&
-			    !ends_with(pkgName, "-dbg") &&
-			    section.compare("devel") &&
-			    section.compare("libdevel")) {
-				return;
-			}
+			pk_bitfield_add (want, PK_FILTER_ENUM_DEVELOPMENT);
 		} else if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DEVELOPMENT)) {
-			std::string pkgName = pkg.Name();
-			if (ends_with(pkgName, "-dev") ||
-			    ends_with(pkgName, "-dbg") ||
-			    !section.compare("devel") ||
-			    !section.compare("libdevel")) {
-				return;
-			}
+			pk_bitfield_add (reject, PK_FILTER_ENUM_DEVELOPMENT);
 		}
 
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_GUI)) {
-			// if ver.end() means unknow
-			// strcmp will be true when it's different than x11
-			if (section.compare("x11") && section.compare("gnome") &&
-			    section.compare("kde") && section.compare("graphics")) {
-				return;
-			}
+			pk_bitfield_add (want, PK_FILTER_ENUM_GUI);
 		} else if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_GUI)) {
-			if (!section.compare("x11") || !section.compare("gnome") ||
-			    !section.compare("kde") || !section.compare("graphics")) {
-				return;
-			}
+			pk_bitfield_add (reject, PK_FILTER_ENUM_GUI);
 		}
 
-		// TODO add Ubuntu handling
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_FREE)) {
-			if (!repo_section.compare("contrib") ||
-			    !repo_section.compare("non-free")) {
-				return;
-			}
+			pk_bitfield_add (reject, PK_FILTER_ENUM_NOT_FREE);
 		} else if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_FREE)) {
-			if (repo_section.compare("contrib") &&
-			    repo_section.compare("non-free")) {
-				return;
-			}
+			pk_bitfield_add (want, PK_FILTER_ENUM_NOT_FREE);
 		}
 
 		// TODO test this one..
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_COLLECTIONS)) {
-			if (!repo_section.compare("metapackages")) {
-				return;
-			}
+			pk_bitfield_add (reject, PK_FILTER_ENUM_COLLECTIONS);
 		} else if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_COLLECTIONS)) {
-			if (repo_section.compare("metapackages")) {
-				return;
-			}
+			pk_bitfield_add (want, PK_FILTER_ENUM_COLLECTIONS);
 		}
 
+		PkBitfield props = getVersionFilters(ver);
+		if ((props & want) != want || (props & reject) != 0) {
+			return;
+		}
 	}
 	pkgCache::VerFileIterator vf = ver.FileList();
 
@@ -584,36 +650,37 @@ void aptcc::emit_details(const pkgCache::PkgIterator &pkg)
 }
 
 // used to emit packages it collects all the needed info
-void aptcc::emit_update_detail(const pkgCache::PkgIterator &pkg)
+string aptcc::getChangelogUri(const pkgCache::PkgIterator &pkg,
+                               string &origin,
+                               string &srcpkg,
+                               string &verstr)
 {
-    // Get the version of the current package
-    pkgCache::VerIterator     currver = find_ver(pkg);
-    pkgCache::VerFileIterator currvf  = currver.FileList();
-    // Build a package_id from the current version
-    gchar *current_package_id;
-    current_package_id = pk_package_id_build(pkg.Name(),
-                                             currver.VerStr(),
-                                             currver.Arch(),
-                                             currvf.File().Archive());
-
     // Get the update version
     pkgCache::VerIterator candver = find_candidate_ver(pkg);
 
     pkgCache::VerFileIterator vf = candver.FileList();
     pkgCache::PkgFileIterator pkgFile = vf.File();
-    string origin = pkgFile.Origin();
+    origin = pkgFile.Origin();
     pkgRecords::Parser &rec = packageRecords->Lookup(candver.FileList());
 
     // Build the changelogURI
     char uri[512];
-    string srcpkg;
-    string verstr;
 
     if (rec.SourcePkg().empty()) {
         srcpkg = pkg.Name();
     } else {
         srcpkg = rec.SourcePkg();
     }
+
+    // the version is also what the changelog is cached with
+    verstr.clear();
+    if(candver.VerStr() != NULL) {
+        verstr = candver.VerStr();
+    }
+    if(verstr.find(':') != verstr.npos) {
+        verstr = string(verstr, verstr.find(':') + 1);
+    }
+
     if (origin.compare("Debian") == 0 || origin.compare("Ubuntu") == 0) {
         string prefix;
 
@@ -629,14 +696,6 @@ void aptcc::emit_update_detail(const pkgCache::PkgIterator &pkg)
             prefix = string("lib") + srcpkg[3];
         }
 
-        if(candver.VerStr() != NULL) {
-            verstr = candver.VerStr();
-        }
-
-        if(verstr.find(':') != verstr.npos) {
-            verstr = string(verstr, verstr.find(':') + 1);
-        }
-
         if (origin.compare("Debian") == 0) {
             snprintf(uri,
                         512,
@@ -677,20 +736,75 @@ void aptcc::emit_update_detail(const pkgCache::PkgIterator &pkg)
                 cadidateOriginSiteUrl.c_str(),
                 pkgfilename.c_str());
     }
+    return uri;
+}
+
+void aptcc::fetchChangelogs(const vector<pkgCache::PkgIterator> &pkgs)
+{
     // Create the download object
     AcqPackageKitStatus Stat(this, m_backend, _cancel);
 
-    // get a fetcher
+    // get a fetcher, all the changelogs are downloaded at the same time
     pkgAcquire fetcher;
     fetcher.Setup(&Stat);
 
-    // fetch the changelog
+    bool queued = false;
+    for (vector<pkgCache::PkgIterator>::const_iterator it = pkgs.begin();
+         it != pkgs.end(); ++it) {
+        string origin;
+        string srcpkg;
+        string verstr;
+        string uri = getChangelogUri(*it, origin, srcpkg, verstr);
+        if (queueChangelogFile(it->Name(),
+                               uri,
+                               getChangelogCacheFile(srcpkg, verstr),
+                               &fetcher)) {
+            queued = true;
+        }
+    }
+
+    // everything we need is already in the cache
+    if (!queued) {
+        return;
+    }
+
     pk_backend_set_status(m_backend, PK_STATUS_ENUM_DOWNLOAD_CHANGELOG);
-    string filename = getChangelogFile(pkg.Name(), origin, verstr, srcpkg, uri, &fetcher);
+    fetcher.Run();
+
+    // don't keep partial or failed downloads in the cache
+    for (pkgAcquire::ItemIterator I = fetcher.ItemsBegin(); I < fetcher.ItemsEnd(); ++I) {
+        if ((*I)->Status != pkgAcquire::Item::StatDone) {
+            unlink((*I)->DestFile.c_str());
+        }
+    }
+}
+
+void aptcc::emit_update_detail(const pkgCache::PkgIterator &pkg)
+{
+    // Get the version of the current package
+    pkgCache::VerIterator     currver = find_ver(pkg);
+    pkgCache::VerFileIterator currvf  = currver.FileList();
+    // Build a package_id from the current version
+    gchar *current_package_id;
+    current_package_id = pk_package_id_build(pkg.Name(),
+                                             currver.VerStr(),
+                                             currver.Arch(),
+                                             currvf.File().Archive());
+
+    // Get the update version
+    pkgCache::VerIterator candver = find_candidate_ver(pkg);
+
+    string origin;
+    string srcpkg;
+    string verstr;
+    string uri = getChangelogUri(pkg, origin, srcpkg, verstr);
+
+    // the changelog was downloaded by fetchChangelogs()
+    string filename = getChangelogCacheFile(srcpkg, verstr);
 
     string changelog;
     string update_text;
-    ifstream in(filename.c_str());
+    stringstream in(getChangelog(pkg.Name(), origin, verstr, srcpkg, uri, filename));
     string line;
     GRegex *regexVer;
     regexVer = g_regex_new("(?'source'.+) \\((?'version'.*)\\) "
@@ -793,7 +907,6 @@ void aptcc::emit_update_detail(const pkgCache::PkgIterator &pkg)
     // Clean structures
     g_regex_unref(regexVer);
     g_regex_unref(regexDate);
-    unlink(filename.c_str());
 
     // Check if the update was updates since it was issued
     if (issued.compare(updated) == 0) {
@@ -846,6 +959,19 @@ void aptcc::emit_update_detail(const pkgCache::PkgIterator &pkg)
 void aptcc::get_depends(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &output,
 			pkgCache::PkgIterator pkg,
 			bool recursive)
+{
+	vector<bool> visited(packageCache->Head().PackageCount, false);
+	for (vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::iterator it = output.begin();
+	     it != output.end(); ++it) {
+		visited[it->first->ID] = true;
+	}
+	get_depends(output, pkg, recursive, visited);
+}
+
+void aptcc::get_depends(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &output,
+			pkgCache::PkgIterator pkg,
+			bool recursive,
+			vector<bool> &visited)
 {
 	pkgCache::DepIterator dep = find_ver(pkg).DependsList();
 	while (!dep.end()) {
@@ -859,9 +985,10 @@ void aptcc::get_depends(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator
 			continue;
 		} else if (dep->Type == pkgCache::Dep::Depends) {
 			if (recursive) {
-				if (!contains(output, dep.TargetPkg())) {
+				if (!visited[dep.TargetPkg()->ID]) {
+					visited[dep.TargetPkg()->ID] = true;
 					output.push_back(pair<pkgCache::PkgIterator, pkgCache::VerIterator>(dep.TargetPkg(), ver));
-					get_depends(output, dep.TargetPkg(), recursive);
+					get_depends(output, dep.TargetPkg(), recursive, visited);
 				}
 			} else {
 				output.push_back(pair<pkgCache::PkgIterator, pkgCache::VerIterator>(dep.TargetPkg(), ver));
@@ -875,36 +1002,48 @@ void aptcc::get_requires(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterato
 			pkgCache::PkgIterator pkg,
 			bool recursive)
 {
-	for (pkgCache::PkgIterator parentPkg = packageCache->PkgBegin(); !parentPkg.end(); ++parentPkg) {
+	vector<bool> visited(packageCache->Head().PackageCount, false);
+	for (vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::iterator it = output.begin();
+	     it != output.end(); ++it) {
+		visited[it->first->ID] = true;
+	}
+	get_requires(output, pkg, recursive, visited);
+}
+
+void aptcc::get_requires(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &output,
+			pkgCache::PkgIterator pkg,
+			bool recursive,
+			vector<bool> &visited)
+{
+	// Packages that exist only due to dependencies don't have requires
+	if (find_ver(pkg).end()) {
+		return;
+	}
+
+	// The cache already has the reverse dependencies of each package,
+	// so use them rather than checking the depends of every package
+	for (pkgCache::DepIterator dep = pkg.RevDependsList(); !dep.end(); ++dep) {
 		if (_cancel) {
 			break;
 		}
-		// Ignore packages that exist only due to dependencies.
-		if (parentPkg.VersionList().end() && parentPkg.ProvidesList().end()) {
+		if (dep->Type != pkgCache::Dep::Depends) {
 			continue;
 		}
 
-		// Don't insert virtual packages instead add what it provides
+		// Only count the version of the parent we would show
+		pkgCache::PkgIterator parentPkg = dep.ParentPkg();
 		pkgCache::VerIterator ver = find_ver(parentPkg);
-		if (ver.end() == false) {
-			vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > deps;
-			get_depends(deps, parentPkg, false);
-			for (vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> >::iterator i=deps.begin();
-			    i != deps.end();
-			    ++i)
-			{
-				if (i->first == pkg) {
-					if (recursive) {
-						if (!contains(output, parentPkg)) {
-							output.push_back(pair<pkgCache::PkgIterator, pkgCache::VerIterator>(parentPkg, ver));
-							get_requires(output, parentPkg, recursive);
-						}
-					} else {
-						output.push_back(pair<pkgCache::PkgIterator, pkgCache::VerIterator>(parentPkg, ver));
-					}
-					break;
-				}
-			}
+		if (ver.end() || dep.ParentVer() != ver) {
+			continue;
+		}
+
+		if (visited[parentPkg->ID]) {
+			continue;
+		}
+		visited[parentPkg->ID] = true;
+		output.push_back(pair<pkgCache::PkgIterator, pkgCache::VerIterator>(parentPkg, ver));
+		if (recursive) {
+			get_requires(output, parentPkg, recursive, visited);
 		}
 	}
 }
@@ -1094,13 +1233,10 @@ vector<string> searchMimeType (PkBackend *backend, gchar **values, bool &error,
 // used to emit files it reads the info directly from the files
 void emit_files (PkBackend *backend, const gchar *pi)
 {
-	static string filelist;
 	string line;
 	gchar **parts;
 
 	parts = pk_package_id_split (pi);
-	filelist.erase(filelist.begin(), filelist.end());
-
 	string f = "/var/lib/dpkg/info/" +
 		   string(parts[PK_PACKAGE_ID_NAME]) +
 		   ".list";
@@ -1111,20 +1247,13 @@ void emit_files (PkBackend *backend, const gchar *pi)
 		if (!in != 0) {
 			return;
 		}
-		while (in.eof() == false && filelist.empty()) {
-			getline(in, line);
-			filelist += line;
-		}
-		while (in.eof() == false) {
-			getline(in, line);
+		// hand each file to the backend as we read it, rather than
+		// building one huge ';' separated string for big packages
+		while (getline(in, line)) {
 			if (!line.empty()) {
-				filelist += ";" + line;
+				pk_backend_files_add (backend, pi, line.c_str());
 			}
 		}
-
-		if (!filelist.empty()) {
-			pk_backend_files (backend, pi, filelist.c_str());
-		}
 	}
 }
 
@@ -1909,14 +2038,15 @@ cout << "How odd.. The sizes didn't match, email apt@packages.debian.org";
 	pk_backend_set_status (m_backend, PK_STATUS_ENUM_DOWNLOAD);
 	pk_backend_set_simultaneous_mode(m_backend, true);
 	// Download and check if we can continue
-	if (fetcher.Run() != pkgAcquire::Continue
+	pkgAcquire::RunResult runResult = fetcher.Run();
+	pk_backend_set_simultaneous_mode(m_backend, false);
+	if (runResult != pkgAcquire::Continue
 	    && _cancel == false)
 	{
 		// We failed and we did not cancel
 		show_errors(m_backend, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED);
 		return false;
 	}
-	pk_backend_set_simultaneous_mode(m_backend, false);
 
 	if (_error->PendingError() == true) {
 		cout << "PendingError download" << endl;
@@ -113,7 +113,13 @@ public:
 	void emit_details(const pkgCache::PkgIterator &pkg);
 
 	/**
-	 *  Emits update detail
+	 *  Downloads the changelogs of the updates that are not cached yet,
+	 *  all at the same time
+	 */
+	void fetchChangelogs(const vector<pkgCache::PkgIterator> &pkgs);
+
+	/**
+	 *  Emits update detail, fetchChangelogs() must be called first
 	 */
 	void emit_update_detail(const pkgCache::PkgIterator &pkg);
 
@@ -151,6 +157,35 @@ private:
 	 *  interprets dpkg status fd
 	*/
 	void updateInterface(int readFd, int writeFd);
+
+	/**
+	 *  returns where the changelog of the candidate version is downloaded from
+	 */
+	string getChangelogUri(const pkgCache::PkgIterator &pkg,
+			       string &origin,
+			       string &srcpkg,
+			       string &verstr);
+
+	/**
+	 *  walk the dependency graph, visited is indexed by package ID
+	 *  so each package is only expanded once
+	 */
+	void get_depends(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &output,
+			 pkgCache::PkgIterator pkg,
+			 bool recursive,
+			 vector<bool> &visited);
+	void get_requires(vector<pair<pkgCache::PkgIterator, pkgCache::VerIterator> > &output,
+			  pkgCache::PkgIterator pkg,
+			  bool recursive,
+			  vector<bool> &visited);
+	/**
+	 *  returns the filter properties of a version, they are computed the
+	 *  first time they are needed and remembered for as long as the cache
+	 *  file is not rebuilt, so emit_package only has to test bits
+	 */
+	PkBitfield getVersionFilters(const pkgCache::VerIterator &ver);
+	void syncVersionFilters();
+
 	bool DoAutomaticRemove(pkgCacheFile &Cache);
 	void emitChangedPackages(pkgCacheFile &Cache);
 	bool removingEssentialPackages(pkgCacheFile &Cache);
@@ -166,6 +201,7 @@ private:
 	// when the internal terminal timesout after no activity
 	int m_terminalTimeout;
 	pid_t m_child_pid;
+	bool m_verFiltersSynced;
 };
 
 #endif
@@ -327,38 +327,55 @@ backend_get_details_thread (PkBackend *backend)
         pkgInitSystem(*_config, _system);
     }
 
+	// the ids before a bad one are still emitted, as when each was
+	// emitted as soon as it was resolved
+	vector<pkgCache::PkgIterator> pkgs;
+	PkErrorEnum error = PK_ERROR_ENUM_UNKNOWN;
+	const gchar *error_details = NULL;
 	pk_backend_set_status (backend, PK_STATUS_ENUM_QUERY);
 	for (uint i = 0; i < g_strv_length(package_ids); i++) {
 		pi = package_ids[i];
 		if (pk_package_id_check(pi) == false) {
-			pk_backend_error_code (backend,
-					       PK_ERROR_ENUM_PACKAGE_ID_INVALID,
-					       pi);
-			delete m_apt;
-			pk_backend_finished (backend);
-			return false;
+			error = PK_ERROR_ENUM_PACKAGE_ID_INVALID;
+			error_details = pi;
+			break;
 		}
 
 		pair<pkgCache::PkgIterator, pkgCache::VerIterator> pkg_ver;
 		pkg_ver = m_apt->find_package_id(pi);
 		if (pkg_ver.second.end() == true)
 		{
-			pk_backend_error_code (backend,
-					       PK_ERROR_ENUM_PACKAGE_NOT_FOUND,
-					       "couldn't find package");
-
-			delete m_apt;
-			pk_backend_finished (backend);
-			return false;
+			error = PK_ERROR_ENUM_PACKAGE_NOT_FOUND;
+			error_details = "couldn't find package";
+			break;
 		}
 
+		pkgs.push_back(pkg_ver.first);
+	}
+
+	// get all the changelogs at once rather than one by one
+	if (updateDetail) {
+		m_apt->fetchChangelogs(pkgs);
+	}
+
+	for (vector<pkgCache::PkgIterator>::iterator it = pkgs.begin(); it != pkgs.end(); ++it) {
+		if (_cancel) {
+			break;
+		}
 		if (updateDetail) {
-			m_apt->emit_update_detail(pkg_ver.first);
+			m_apt->emit_update_detail(*it);
 		} else {
-			m_apt->emit_details(pkg_ver.first);
+			m_apt->emit_details(*it);
 		}
 	}
 
+	if (error != PK_ERROR_ENUM_UNKNOWN) {
+		pk_backend_error_code (backend, error, error_details);
+		delete m_apt;
+		pk_backend_finished (backend);
+		return false;
+	}
+
 	delete m_apt;
 	pk_backend_finished (backend);
 	return true;
@@ -687,7 +704,12 @@ backend_download_packages_thread (PkBackend *backend)
 		}
 	}
 
-	if (fetcher.Run() != pkgAcquire::Continue
+	// the items are downloaded at the same time
+	pk_backend_set_status (backend, PK_STATUS_ENUM_DOWNLOAD);
+	pk_backend_set_simultaneous_mode(backend, true);
+	pkgAcquire::RunResult res = fetcher.Run();
+	pk_backend_set_simultaneous_mode(backend, false);
+	if (res != pkgAcquire::Continue
 	    && _cancel == false)
 	// We failed and we did not cancel
 	{
@@ -748,9 +770,21 @@ backend_refresh_cache_thread (PkBackend *backend)
 	// Create the progress
 	AcqPackageKitStatus Stat(m_apt, backend, _cancel);
 
-	// do the work
+	// do the work, the indexes that did not change are not downloaded
+	// again (If-Modified-Since) and the ones that did are patched with
+	// pdiffs where the archive has them
+	_config->CndSet("Acquire::PDiffs", "true");
 	ListUpdate(Stat, *m_apt->packageSourceList);
 
+	// the lists that were completed are already in place and partial
+	// ones are kept to be resumed, the cache is rebuilt the next time
+	// it is opened
+	if (_cancel) {
+		delete m_apt;
+		pk_backend_finished (backend);
+		return true;
+	}
+
 	// Rebuild the cache.
 	pkgCacheFile Cache;
 	OpTextProgress Prog(*_config);
@@ -769,6 +803,11 @@ backend_refresh_cache_thread (PkBackend *backend)
 		show_warnings(backend, PK_MESSAGE_ENUM_UNTRUSTED_PACKAGE);
 	}
 
+	// drop the changelogs of versions that have been superseded
+	if (Cache.Open(&Prog, false)) {
+		pruneChangelogCache(Cache);
+	}
+
 	pk_backend_finished (backend);
 	delete m_apt;
 	return true;
@@ -43,6 +43,37 @@ typedef struct {
 	PkBackend *backend;
 } SearchParams;
 
+#define PK_OPKG_INDEX_FILENAME		"/var/cache/PackageKit/opkg-index.dat"
+#define PK_OPKG_INDEX_MAGIC		"PKOPKG01"
+
+enum {
+	PK_OPKG_INDEX_FLAG_INSTALLED	= 1 << 0,
+	PK_OPKG_INDEX_FLAG_DEVEL	= 1 << 1,
+	PK_OPKG_INDEX_FLAG_GUI		= 1 << 2
+};
+
+/* The package index is a file which is mapped into memory, so the
+ * feeds don't have to be walked (and every package allocated) for each
+ * query. It is laid out as the header, then the entries sorted by
+ * name, then a string table. All strings are offsets into that table,
+ * and offset 0 is always the empty string. */
+typedef struct {
+	gchar	magic[8];
+	guint32	n_entries;
+	guint32	strings_offset;
+} PkOpkgIndexHeader;
+
+typedef struct {
+	guint32	name;
+	guint32	version;
+	guint32	arch;
+	guint32	description;
+	guint32	tags;
+	guint32	flags;
+} PkOpkgIndexEntry;
+
+static GMappedFile *opkg_index = NULL;
+
 static void
 opkg_unknown_error (PkBackend *backend, gint error_code, const gchar *failed_cmd)
 {
@@ -111,6 +142,279 @@ opkg_check_tag (pkg_t *pkg, const gchar *tag)
 		return FALSE;
 }
 
+/**
+ * opkg_index_get_header:
+ */
+static const PkOpkgIndexHeader *
+opkg_index_get_header (void)
+{
+	return (const PkOpkgIndexHeader *) g_mapped_file_get_contents (opkg_index);
+}
+
+/**
+ * opkg_index_get_entry:
+ */
+static const PkOpkgIndexEntry *
+opkg_index_get_entry (guint idx)
+{
+	const gchar *contents = g_mapped_file_get_contents (opkg_index);
+	return ((const PkOpkgIndexEntry *) (contents + sizeof (PkOpkgIndexHeader))) + idx;
+}
+
+/**
+ * opkg_index_get_string:
+ */
+static const gchar *
+opkg_index_get_string (guint32 offset)
+{
+	return g_mapped_file_get_contents (opkg_index) + opkg_index_get_header ()->strings_offset + offset;
+}
+
+/**
+ * opkg_index_unload:
+ */
+static void
+opkg_index_unload (void)
+{
+	if (opkg_index == NULL)
+		return;
+	g_mapped_file_unref (opkg_index);
+	opkg_index = NULL;
+}
+
+/**
+ * opkg_index_load:
+ *
+ * map the index into memory, rejecting files that don't look sane
+ */
+static gboolean
+opkg_index_load (void)
+{
+	const PkOpkgIndexHeader *header;
+	const PkOpkgIndexEntry *entry;
+	const gchar *contents;
+	gsize length;
+	gsize strings_end;
+	gsize strings_length;
+	guint i;
+
+	opkg_index_unload ();
+
+	opkg_index = g_mapped_file_new (PK_OPKG_INDEX_FILENAME, FALSE, NULL);
+	if (opkg_index == NULL)
+		return FALSE;
+
+	contents = g_mapped_file_get_contents (opkg_index);
+	length = g_mapped_file_get_length (opkg_index);
+	if (length < sizeof (PkOpkgIndexHeader))
+		goto invalid;
+
+	header = (const PkOpkgIndexHeader *) contents;
+	if (memcmp (header->magic, PK_OPKG_INDEX_MAGIC, sizeof (header->magic)) != 0)
+		goto invalid;
+	if (header->n_entries > (length - sizeof (PkOpkgIndexHeader)) / sizeof (PkOpkgIndexEntry))
+		goto invalid;
+	if (header->strings_offset != sizeof (PkOpkgIndexHeader) + (gsize) header->n_entries * sizeof (PkOpkgIndexEntry))
+		goto invalid;
+
+	/* the string table starts with the empty string and is nul terminated */
+	strings_end = length - 1;
+	if (header->strings_offset >= length ||
+	    contents[header->strings_offset] != '\0' ||
+	    contents[strings_end] != '\0')
+		goto invalid;
+
+	/* every string has to start inside the table, so a truncated or
+	 * corrupt file can't make us read past the end of the mapping */
+	strings_length = length - header->strings_offset;
+	for (i=0; i<header->n_entries; i++) {
+		entry = opkg_index_get_entry (i);
+		if (entry->name >= strings_length ||
+		    entry->version >= strings_length ||
+		    entry->arch >= strings_length ||
+		    entry->description >= strings_length ||
+		    entry->tags >= strings_length)
+			goto invalid;
+	}
+
+	return TRUE;
+invalid:
+	g_debug ("ignoring invalid package index %s", PK_OPKG_INDEX_FILENAME);
+	opkg_index_unload ();
+	return FALSE;
+}
+
+static void
+opkg_index_collect_cb (pkg_t *pkg, void *data)
+{
+	GPtrArray *pkgs = (GPtrArray *) data;
+
+	if (pkg->name)
+		g_ptr_array_add (pkgs, pkg);
+}
+
+static gint
+opkg_index_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const pkg_t *pkg_a = *((const pkg_t **) a);
+	const pkg_t *pkg_b = *((const pkg_t **) b);
+
+	return strcmp (pkg_a->name, pkg_b->name);
+}
+
+static guint32
+opkg_index_add_string (GString *strings, GHashTable *offsets, const gchar *str)
+{
+	gpointer offset;
+
+	if (str == NULL || str[0] == '\0')
+		return 0;
+
+	/* versions, archs and tags are shared by many packages */
+	if (g_hash_table_lookup_extended (offsets, str, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
+
+	offset = GUINT_TO_POINTER (strings->len);
+	g_hash_table_insert (offsets, (gpointer) str, offset);
+	g_string_append_len (strings, str, strlen (str) + 1);
+
+	return GPOINTER_TO_UINT (offset);
+}
+
+/**
+ * opkg_index_build:
+ *
+ * walk the feeds once and write a new package index
+ */
+static gboolean
+opkg_index_build (void)
+{
+	PkOpkgIndexHeader header;
+	PkOpkgIndexEntry *entries;
+	GPtrArray *pkgs;
+	GHashTable *offsets;
+	GString *strings;
+	GString *data;
+	GError *error = NULL;
+	gboolean ret;
+	pkg_t *pkg;
+	guint i;
+
+	pkgs = g_ptr_array_new ();
+	opkg_list_packages (opkg_index_collect_cb, pkgs);
+	g_ptr_array_sort (pkgs, opkg_index_sort_cb);
+
+	offsets = g_hash_table_new (g_str_hash, g_str_equal);
+	strings = g_string_new_len ("", 1);
+	entries = g_new0 (PkOpkgIndexEntry, pkgs->len);
+
+	for (i = 0; i < pkgs->len; i++) {
+		pkg = g_ptr_array_index (pkgs, i);
+
+		entries[i].name = opkg_index_add_string (strings, offsets, pkg->name);
+		entries[i].version = opkg_index_add_string (strings, offsets, pkg->version);
+		entries[i].arch = opkg_index_add_string (strings, offsets, pkg->architecture);
+		entries[i].description = opkg_index_add_string (strings, offsets, pkg->description);
+		entries[i].tags = opkg_index_add_string (strings, offsets, pkg->tags);
+		if (pkg->state_status == SS_INSTALLED)
+			entries[i].flags |= PK_OPKG_INDEX_FLAG_INSTALLED;
+		if (opkg_is_devel_pkg (pkg))
+			entries[i].flags |= PK_OPKG_INDEX_FLAG_DEVEL;
+		if (opkg_is_gui_pkg (pkg))
+			entries[i].flags |= PK_OPKG_INDEX_FLAG_GUI;
+	}
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, PK_OPKG_INDEX_MAGIC, sizeof (header.magic));
+	header.n_entries = pkgs->len;
+	header.strings_offset = sizeof (PkOpkgIndexHeader) + pkgs->len * sizeof (PkOpkgIndexEntry);
+
+	data = g_string_sized_new (header.strings_offset + strings->len);
+	g_string_append_len (data, (const gchar *) &header, sizeof (header));
+	g_string_append_len (data, (const gchar *) entries, pkgs->len * sizeof (PkOpkgIndexEntry));
+	g_string_append_len (data, strings->str, strings->len);
+
+	/* this is atomic, so an old mapping stays valid until it is dropped */
+	ret = g_file_set_contents (PK_OPKG_INDEX_FILENAME, data->str, data->len, &error);
+	if (!ret) {
+		g_warning ("failed to write package index: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_string_free (data, TRUE);
+	g_string_free (strings, TRUE);
+	g_hash_table_destroy (offsets);
+	g_free (entries);
+	g_ptr_array_free (pkgs, TRUE);
+
+	if (!ret)
+		return FALSE;
+	return opkg_index_load ();
+}
+
+/**
+ * opkg_index_ensure:
+ */
+static gboolean
+opkg_index_ensure (void)
+{
+	if (opkg_index != NULL)
+		return TRUE;
+	if (opkg_index_load ())
+		return TRUE;
+	return opkg_index_build ();
+}
+
+/**
+ * opkg_index_entry_is_filtered:
+ *
+ * returns TRUE if the entry should not be shown with these filters
+ */
+static gboolean
+opkg_index_entry_is_filtered (const PkOpkgIndexEntry *entry, PkBitfield filters)
+{
+	gboolean devel = (entry->flags & PK_OPKG_INDEX_FLAG_DEVEL) != 0;
+	gboolean gui = (entry->flags & PK_OPKG_INDEX_FLAG_GUI) != 0;
+	gboolean installed = (entry->flags & PK_OPKG_INDEX_FLAG_INSTALLED) != 0;
+
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_DEVELOPMENT) && !devel)
+		return TRUE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DEVELOPMENT) && devel)
+		return TRUE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_GUI) && !gui)
+		return TRUE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_GUI) && gui)
+		return TRUE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && !installed)
+		return TRUE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && installed)
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * opkg_index_emit_entry:
+ */
+static void
+opkg_index_emit_entry (PkBackend *backend, const PkOpkgIndexEntry *entry)
+{
+	gchar *uid;
+	gint status;
+
+	uid = g_strdup_printf ("%s;%s;%s;",
+		opkg_index_get_string (entry->name),
+		opkg_index_get_string (entry->version),
+		opkg_index_get_string (entry->arch));
+
+	if (entry->flags & PK_OPKG_INDEX_FLAG_INSTALLED)
+		status = PK_INFO_ENUM_INSTALLED;
+	else
+		status = PK_INFO_ENUM_AVAILABLE;
+
+	pk_backend_package (backend, status, uid, opkg_index_get_string (entry->description));
+	g_free (uid);
+}
+
 static void
 handle_install_error (PkBackend *backend, int err)
 {
@@ -164,6 +468,8 @@ backend_initialize (PkBackend *backend)
 	opkg_re_read_config_files ();
 #endif
 
+	/* an index from a previous run is fine, it's rebuilt on refresh */
+	opkg_index_load ();
 }
 
 /**
@@ -172,6 +478,7 @@ backend_initialize (PkBackend *backend)
 static void
 backend_destroy (PkBackend *backend)
 {
+	opkg_index_unload ();
 	opkg_free ();
 }
 
@@ -229,6 +536,8 @@ backend_refresh_cache_thread (PkBackend *backend)
 //			pk_backend_error_code (backend, PK_ERROR_ENUM_REPO_NOT_AVAILABLE, NULL);
 //		else
 			opkg_unknown_error (backend, ret, "Refreshing cache");
+	} else {
+		opkg_index_build ();
 	}
 	pk_backend_finished (backend);
 
@@ -327,14 +636,50 @@ end_handle:
 
 }
 
+static gboolean
+opkg_index_entry_matches (const PkOpkgIndexEntry *entry, SearchParams *params)
+{
+	gchar *haystack;
+	gboolean match;
+
+	switch (params->search_type)
+	{
+		case SEARCH_NAME:
+			haystack = g_utf8_strdown (opkg_index_get_string (entry->name), -1);
+			match = (g_strrstr (haystack, params->needle) != NULL);
+			g_free (haystack);
+			return match;
+		case SEARCH_DESCRIPTION:
+			haystack = g_utf8_strdown (opkg_index_get_string (entry->description), -1);
+			match = (g_strrstr (haystack, params->needle) != NULL);
+			g_free (haystack);
+			return match;
+		case SEARCH_TAG:
+			return (g_strrstr (opkg_index_get_string (entry->tags), params->needle) != NULL);
+	}
+	return FALSE;
+}
+
 static gboolean
 backend_search_thread (PkBackend *backend)
 {
 	SearchParams *params;
+	const PkOpkgIndexEntry *entry;
+	guint i;
 
 	params = pk_backend_get_pointer (backend, "search-params");
 
-	opkg_list_packages (pk_opkg_package_list_cb, params);
+	if (opkg_index_ensure ()) {
+		for (i = 0; i < opkg_index_get_header ()->n_entries; i++) {
+			entry = opkg_index_get_entry (i);
+			if (opkg_index_entry_is_filtered (entry, params->filters))
+				continue;
+			if (opkg_index_entry_matches (entry, params))
+				opkg_index_emit_entry (backend, entry);
+		}
+	} else {
+		opkg_list_packages (pk_opkg_package_list_cb, params);
+	}
 
 	pk_backend_finished (params->backend);
 
@@ -427,6 +772,9 @@ backend_install_packages_thread (PkBackend *backend)
 			break;
 	}
 
+	/* the installed state of packages has changed */
+	opkg_index_build ();
+
 	pk_backend_finished (backend);
 	return (err == 0);
 }
@@ -488,6 +836,9 @@ backend_remove_packages_thread (PkBackend *backend)
 			break;
 	}
 
+	/* the installed state of packages has changed */
+	opkg_index_build ();
+
 	pk_backend_finished (backend);
 	return (err == 0);
 }
@@ -537,6 +888,9 @@ backend_update_system_thread (PkBackend *backend)
 	if (err)
 		opkg_unknown_error (backend, err, "Upgrading system");
 
+	/* the installed state of packages has changed */
+	opkg_index_build ();
+
 	pk_backend_finished (backend);
 	return (err != 0);
 }
@@ -576,6 +930,9 @@ backend_update_package_thread (PkBackend *backend)
 	if (err)
 		handle_install_error (backend, err);
 
+	/* the installed state of packages has changed */
+	opkg_index_build ();
+
 	g_strfreev (parts);
 	pk_backend_finished (backend);
 	return (err != 0);
@@ -635,6 +992,117 @@ backend_get_updates (PkBackend *backend, PkBitfield filters)
 	pk_backend_thread_create (backend, backend_get_updates_thread);
 }
 
+/**
+ * backend_resolve_name_cb:
+ *
+ * runs on the worker threads, which only read the mapped index
+ */
+static gboolean
+backend_resolve_name_cb (PkBackend *backend, const gchar *name, gpointer user_data)
+{
+	PkBitfield filters = *((PkBitfield *) user_data);
+	const PkOpkgIndexEntry *entry;
+	guint n_entries;
+	guint lower, upper, mid;
+	gint cmp;
+
+	/* find the first entry with this name */
+	n_entries = opkg_index_get_header ()->n_entries;
+	lower = 0;
+	upper = n_entries;
+	while (lower < upper) {
+		mid = lower + (upper - lower) / 2;
+		cmp = strcmp (opkg_index_get_string (opkg_index_get_entry (mid)->name), name);
+		if (cmp < 0)
+			lower = mid + 1;
+		else
+			upper = mid;
+	}
+
+	for (; lower < n_entries; lower++) {
+		entry = opkg_index_get_entry (lower);
+		if (strcmp (opkg_index_get_string (entry->name), name) != 0)
+			break;
+		if (!opkg_index_entry_is_filtered (entry, filters))
+			opkg_index_emit_entry (backend, entry);
+	}
+	return TRUE;
+}
+
+/**
+ * backend_resolve:
+ */
+static gboolean
+backend_resolve_thread (PkBackend *backend)
+{
+	gchar **package_ids;
+	PkBitfield filters;
+
+	package_ids = pk_backend_get_strv (backend, "package_ids");
+	filters = (PkBitfield) pk_backend_get_uint (backend, "filters");
+
+	if (!opkg_index_ensure ()) {
+		pk_backend_error_code (backend, PK_ERROR_ENUM_FAILED_INITIALIZATION,
+				"Could not build the package index");
+		pk_backend_finished (backend);
+		return FALSE;
+	}
+
+	/* each name is looked up on its own, and nothing writes to the
+	 * index until the next refresh, so the names can be shared out */
+	pk_backend_thread_foreach (backend, package_ids, backend_resolve_name_cb, &filters);
+
+	pk_backend_finished (backend);
+	return TRUE;
+}
+
+static void
+backend_resolve (PkBackend *backend, PkBitfield filters, gchar **package_ids)
+{
+	pk_backend_set_status (backend, PK_STATUS_ENUM_QUERY);
+	pk_backend_set_percentage (backend, PK_BACKEND_PERCENTAGE_INVALID);
+
+	pk_backend_thread_create (backend, backend_resolve_thread);
+}
+
+/**
+ * backend_get_packages:
+ */
+static gboolean
+backend_get_packages_thread (PkBackend *backend)
+{
+	PkBitfield filters;
+	const PkOpkgIndexEntry *entry;
+	guint i;
+
+	filters = (PkBitfield) pk_backend_get_uint (backend, "filters");
+
+	if (!opkg_index_ensure ()) {
+		pk_backend_error_code (backend, PK_ERROR_ENUM_FAILED_INITIALIZATION,
+				"Could not build the package index");
+		pk_backend_finished (backend);
+		return FALSE;
+	}
+
+	for (i = 0; i < opkg_index_get_header ()->n_entries; i++) {
+		entry = opkg_index_get_entry (i);
+		if (!opkg_index_entry_is_filtered (entry, filters))
+			opkg_index_emit_entry (backend, entry);
+	}
+
+	pk_backend_finished (backend);
+	return TRUE;
+}
+
+static void
+backend_get_packages (PkBackend *backend, PkBitfield filters)
+{
+	pk_backend_set_status (backend, PK_STATUS_ENUM_QUERY);
+	pk_backend_set_percentage (backend, PK_BACKEND_PERCENTAGE_INVALID);
+
+	pk_backend_thread_create (backend, backend_get_packages_thread);
+}
+
 /**
  * backend_get_groups:
  */
@@ -725,7 +1193,7 @@ PK_BACKEND_OPTIONS (
 	backend_get_details,			/* get_details */
 	NULL,					/* get_distro_upgrades */
 	NULL,					/* get_files */
-	NULL,					/* get_packages */
+	backend_get_packages,			/* get_packages */
 	NULL,					/* get_repo_list */
 	NULL,					/* get_requires */
 	NULL,					/* get_update_detail */
@@ -737,7 +1205,7 @@ PK_BACKEND_OPTIONS (
 	backend_remove_packages,		/* remove_packages */
 	NULL,					/* repo_enable */
 	NULL,					/* repo_set_data */
-	NULL,					/* resolve */
+	backend_resolve,			/* resolve */
 	NULL,					/* rollback */
 	backend_search_description,		/* search_details */
 	NULL,					/* search_file */
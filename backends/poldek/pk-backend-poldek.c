@@ -20,6 +20,7 @@
  */
 
 #include <pk-backend.h>
+#include <glib/gstdio.h>
 
 #include <log.h>
 #include <capreq.h>
@@ -136,6 +137,11 @@ static gint verbose = 1;
 static PbError *pberror;
 /* cached locale variants */
 static GHashTable *clv;
+/* parsed update metadata, keyed by package NEVRA */
+static GKeyFile *udcache = NULL;
+static gboolean udcache_dirty = FALSE;
+
+#define POLDEK_UPDATE_DETAIL_CACHE	"/var/cache/PackageKit/poldek-update-detail.cache"
 
 static struct poldek_ctx	*ctx = NULL;
 static struct poclidek_ctx	*cctx = NULL;
@@ -1103,6 +1109,132 @@ poldek_pkg_get_cves_from_pld_changelog (struct pkg *pkg, time_t since)
 	return cves;
 }
 
+/**
+ * poldek_pkg_nevra:
+ */
+static gchar*
+poldek_pkg_nevra (const struct pkg *pkg)
+{
+	gchar *evr, *nevra;
+
+	evr = poldek_pkg_evr (pkg);
+	nevra = g_strdup_printf ("%s-%s.%s", pkg->name, evr, pkg_arch (pkg));
+	g_free (evr);
+
+	return nevra;
+}
+
+/**
+ * udcache_load:
+ *
+ * Loads cached update metadata from disk. A missing or broken cache file
+ * just means that everything will be parsed again.
+ **/
+static void
+udcache_load (void)
+{
+	GError *error = NULL;
+
+	udcache = g_key_file_new ();
+	udcache_dirty = FALSE;
+
+	if (!g_key_file_load_from_file (udcache, POLDEK_UPDATE_DETAIL_CACHE, G_KEY_FILE_NONE, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("failed to load update detail cache: %s", error->message);
+		g_error_free (error);
+	}
+}
+
+/**
+ * udcache_save:
+ **/
+static void
+udcache_save (void)
+{
+	GError *error = NULL;
+	gchar *data;
+	gsize length;
+
+	if (!udcache_dirty)
+		return;
+
+	data = g_key_file_to_data (udcache, &length, NULL);
+	if (!g_file_set_contents (POLDEK_UPDATE_DETAIL_CACHE, data, length, &error)) {
+		g_warning ("failed to save update detail cache: %s", error->message);
+		g_error_free (error);
+	} else {
+		udcache_dirty = FALSE;
+	}
+
+	g_free (data);
+}
+
+/**
+ * udcache_clear:
+ *
+ * Repositories have changed, so forget everything we knew about updates.
+ **/
+static void
+udcache_clear (void)
+{
+	g_key_file_free (udcache);
+	udcache = g_key_file_new ();
+	udcache_dirty = FALSE;
+
+	g_unlink (POLDEK_UPDATE_DETAIL_CACHE);
+}
+
+/**
+ * udcache_get_cves:
+ *
+ * Returns CVE ids mentioned in the changelog of pkg since specified time.
+ * Changelogs are parsed only once for every NEVRA, results are kept in
+ * udcache. Returned value must be released with g_strfreev().
+ **/
+static gchar**
+udcache_get_cves (struct pkg *pkg, time_t since)
+{
+	gchar *nevra, *since_str;
+	gchar **cves = NULL;
+	gchar *cached_since;
+
+	g_return_val_if_fail (pkg != NULL, NULL);
+
+	nevra = poldek_pkg_nevra (pkg);
+	since_str = g_strdup_printf ("%lu", (gulong) since);
+
+	cached_since = g_key_file_get_string (udcache, nevra, "Since", NULL);
+
+	if (g_strcmp0 (cached_since, since_str) == 0) {
+		cves = g_key_file_get_string_list (udcache, nevra, "Cves", NULL, NULL);
+	} else {
+		tn_array *array;
+		guint i;
+
+		cves = g_new0 (gchar *, 1);
+
+		if ((array = poldek_pkg_get_cves_from_pld_changelog (pkg, since))) {
+			g_free (cves);
+			cves = g_new0 (gchar *, n_array_size (array) + 1);
+
+			for (i = 0; i < n_array_size (array); i++)
+				cves[i] = g_strdup (n_array_nth (array, i));
+
+			n_array_free (array);
+		}
+
+		g_key_file_set_string (udcache, nevra, "Since", since_str);
+		g_key_file_set_string_list (udcache, nevra, "Cves", (const gchar * const *) cves, g_strv_length (cves));
+		udcache_dirty = TRUE;
+	}
+
+	g_free (cached_since);
+	g_free (since_str);
+	g_free (nevra);
+
+	return cves;
+}
+
 /**
  * poldek_pkg_is_devel:
  */
@@ -2228,6 +2360,8 @@ backend_initalize (PkBackend *backend)
 
 	clv = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)n_array_free);
 
+	udcache_load ();
+
 	pberror = g_new0 (PbError, 1);
 	pberror->tslog = g_string_new ("");
 
@@ -2249,6 +2383,8 @@ backend_destroy (PkBackend *backend)
 
 	g_hash_table_destroy (clv);
 
+	g_key_file_free (udcache);
+
 	g_free (pberror);
 }
 
@@ -2768,7 +2904,7 @@ backend_get_update_detail_thread (PkBackend *backend)
 				gchar *obsoletes = NULL;
 				gchar *cve_url = NULL;
 				const gchar *changes = NULL;
-				tn_array *cves = NULL;
+				gchar **cves = NULL;
 				struct pkguinf *upkg_uinf = NULL;
 
 				updates = package_id_from_pkg (pkg, "installed", 0);
@@ -2781,20 +2917,19 @@ backend_get_update_detail_thread (PkBackend *backend)
 					changes = pkguinf_get_changelog (upkg_uinf, pkg->btime);
 				}
 
-				if ((cves = poldek_pkg_get_cves_from_pld_changelog (upkg, pkg->btime))) {
+				cves = udcache_get_cves (upkg, pkg->btime);
+				if (cves != NULL && cves[0] != NULL) {
 					GString *string;
 					guint i;
 
 					string = g_string_new ("");
 
-					for (i = 0; i < n_array_size (cves); i++) {
-						gchar *cve = n_array_nth (cves, i);
-
+					for (i = 0; cves[i] != NULL; i++) {
 						g_string_append_printf (string,
 									"http://nvd.nist.gov/nvd.cfm?cvename=%s;%s",
-									cve, cve);
+									cves[i], cves[i]);
 
-						if ((i + 1) < n_array_size (cves))
+						if (cves[i + 1] != NULL)
 							g_string_append_printf (string, ";");
 					}
 
@@ -2815,7 +2950,7 @@ backend_get_update_detail_thread (PkBackend *backend)
 				g_free (obsoletes);
 				g_free (cve_url);
 
-				n_array_cfree (&cves);
+				g_strfreev (cves);
 			}
 
 			n_array_free (packages);
@@ -2834,6 +2969,9 @@ backend_get_update_detail_thread (PkBackend *backend)
 		g_strfreev (parts);
 	}
 
+	/* write newly parsed changelogs back in one go */
+	udcache_save ();
+
 	pk_backend_finished (backend);
 	return TRUE;
 }
@@ -3019,6 +3157,8 @@ backend_refresh_cache_thread (PkBackend *backend)
 
 	poldek_reload (backend, TRUE);
 
+	udcache_clear ();
+
 	pk_backend_set_percentage (backend, 100);
 
 	poldek_backend_percentage_data_destroy (backend);
@@ -28,6 +28,7 @@
 #include <razor/razor.h>
 
 static struct razor_set *set = NULL;
+static PkBackendPackageTable *package_table = NULL;
 static const char *repo_filename = "/home/hughsie/Code/razor/src/system.repo";
 static const char *system_details = "/home/hughsie/Code/razor/src/system-details.repo";
 
@@ -42,8 +43,27 @@ typedef enum {
 static void
 backend_initialize (PkBackend *backend)
 {
+	struct razor_package_iterator *pi;
+	struct razor_package *package;
+	const gchar *name, *version, *arch;
+	gchar *package_id;
+
 	set = razor_set_open (repo_filename);
 	razor_set_open_details (set, system_details);
+
+	/* build the package_id of each package once, as the set does not change */
+	package_table = pk_backend_package_table_new ();
+	pi = razor_package_iterator_create (set);
+	while (razor_package_iterator_next (pi, &package,
+					    RAZOR_DETAIL_NAME, &name,
+					    RAZOR_DETAIL_VERSION, &version,
+					    RAZOR_DETAIL_ARCH, &arch,
+					    RAZOR_DETAIL_LAST)) {
+		package_id = pk_package_id_build (name, version, arch, "installed");
+		pk_backend_package_table_add (package_table, package, package_id);
+		g_free (package_id);
+	}
+	razor_package_iterator_destroy (pi);
 }
 
 /**
@@ -52,6 +72,7 @@ backend_initialize (PkBackend *backend)
 static void
 backend_destroy (PkBackend *backend)
 {
+	pk_backend_package_table_free (package_table);
 	razor_set_destroy (set);
 }
 
@@ -74,10 +95,9 @@ pk_razor_filter_devel (const gchar *name)
  * pk_razor_emit_package:
  */
 static gboolean
-pk_razor_emit_package (PkBackend *backend, const gchar *name, const gchar *version, const gchar *arch, const gchar *summary)
+pk_razor_emit_package (PkBackend *backend, struct razor_package *package, const gchar *name, const gchar *summary)
 {
 	PkBitfield filters;
-	gchar *package_id;
 	gboolean ret;
 
 	filters = pk_backend_get_uint (backend, "filters");
@@ -93,9 +113,8 @@ pk_razor_emit_package (PkBackend *backend, const gchar *name, const gchar *versi
 			return FALSE;
 	}
 
-	package_id = pk_package_id_build (name, version, arch, "installed");
-	pk_backend_package (backend, PK_INFO_ENUM_INSTALLED, package_id, summary);
-	g_free (package_id);
+	pk_backend_package (backend, PK_INFO_ENUM_INSTALLED,
+			    pk_backend_package_table_get_id (package_table, package), summary);
 	return TRUE;
 }
 
@@ -106,7 +125,7 @@ backend_resolve_thread (PkBackend *backend)
 	guint length;
 	struct razor_package_iterator *pi;
 	struct razor_package *package;
-	const gchar *name, *version, *arch, *summary;
+	const gchar *name, *summary;
 	gchar **package_ids;
 
 	package_ids = pk_backend_get_strv (backend, "package_ids");
@@ -115,13 +134,11 @@ backend_resolve_thread (PkBackend *backend)
 	pi = razor_package_iterator_create (set);
 	while (razor_package_iterator_next (pi, &package,
 					    RAZOR_DETAIL_NAME, &name,
-					    RAZOR_DETAIL_VERSION, &version,
-					    RAZOR_DETAIL_ARCH, &arch,
 					    RAZOR_DETAIL_SUMMARY, &summary,
 					    RAZOR_DETAIL_LAST)) {
 		for (i=0; i<length; i++) {
 			if (g_strcmp0 (name, package_ids[i]) == 0) {
-				pk_razor_emit_package (backend, name, version, arch, summary);
+				pk_razor_emit_package (backend, package, name, summary);
 			}
 		}
 	}
@@ -142,6 +159,42 @@ backend_resolve (PkBackend *backend, PkBitfield filters, gchar **packages)
 	pk_backend_thread_create (backend, backend_resolve_thread);
 }
 
+/**
+ * backend_resolve_package_id:
+ */
+static struct razor_package *
+backend_resolve_package_id (const gchar *package_id)
+{
+	struct razor_package_iterator *pi;
+	struct razor_package *package;
+	struct razor_package *package_retval = NULL;
+	const gchar *name;
+	gchar **split;
+
+	/* exact match */
+	package_retval = pk_backend_package_table_lookup (package_table, package_id);
+	if (package_retval != NULL)
+		goto out;
+
+	/* fall back to the first package with the same name */
+	split = pk_package_id_split (package_id);
+	if (split == NULL)
+		goto out;
+	pi = razor_package_iterator_create (set);
+	while (razor_package_iterator_next (pi, &package,
+					    RAZOR_DETAIL_NAME, &name,
+					    RAZOR_DETAIL_LAST)) {
+		if (g_strcmp0 (name, split[PK_PACKAGE_ID_NAME]) == 0) {
+			package_retval = package;
+			break;
+		}
+	}
+	razor_package_iterator_destroy (pi);
+	g_strfreev (split);
+out:
+	return package_retval;
+}
+
 /**
  * backend_get_details:
  */
@@ -150,41 +203,26 @@ backend_get_details_thread (PkBackend *backend)
 {
 	guint i;
 	guint length;
-	struct razor_package_iterator *pi;
 	struct razor_package *package;
-	const gchar *name, *version, *arch, *summary, *description, *url, *license;
-	gchar *package_id;
+	const gchar *summary, *description, *url, *license;
 	gchar **package_ids;
-	PkPackageId *id;
 
 	package_ids = pk_backend_get_strv (backend, "package_ids");
 	length = g_strv_length (package_ids);
 
-	pi = razor_package_iterator_create (set);
-	while (razor_package_iterator_next (pi, &package,
-					    RAZOR_DETAIL_NAME, &name,
-					    RAZOR_DETAIL_VERSION, &version,
-					    RAZOR_DETAIL_ARCH, &arch,
-					    RAZOR_DETAIL_LAST)) {
-		for (i=0; i<length; i++) {
-			/* TODO: we should cache this */
-			id = pk_package_id_new_from_string (package_ids[i]);
-			if (g_strcmp0 (name, id->name) == 0) {
-				package_id = pk_package_id_build (name, version, arch, "installed");
-				razor_package_get_details (set, package,
-							   RAZOR_DETAIL_SUMMARY, &summary,
-							   RAZOR_DETAIL_DESCRIPTION, &description,
-							   RAZOR_DETAIL_URL, &url,
-							   RAZOR_DETAIL_LICENSE, &license,
-							   RAZOR_DETAIL_LAST);
-				pk_backend_details (backend, package_ids[i], license, PK_GROUP_ENUM_UNKNOWN, description, url, 0);
-				g_free (package_id);
-			}
-			pk_package_id_free (id);
-		}
+	for (i=0; i<length; i++) {
+		package = backend_resolve_package_id (package_ids[i]);
+		if (package == NULL)
+			continue;
+		razor_package_get_details (set, package,
+					   RAZOR_DETAIL_SUMMARY, &summary,
+					   RAZOR_DETAIL_DESCRIPTION, &description,
+					   RAZOR_DETAIL_URL, &url,
+					   RAZOR_DETAIL_LICENSE, &license,
+					   RAZOR_DETAIL_LAST);
+		pk_backend_details (backend, package_ids[i], license, PK_GROUP_ENUM_UNKNOWN, description, url, 0);
 	}
 
-	razor_package_iterator_destroy (pi);
 	pk_backend_finished (backend);
 	return TRUE;
 }
@@ -197,32 +235,6 @@ backend_get_details (PkBackend *backend, gchar **package_ids)
 	pk_backend_thread_create (backend, backend_get_details_thread);
 }
 
-/**
- * backend_resolve_package_id:
- */
-static struct razor_package *
-backend_resolve_package_id (const PkPackageId *id)
-{
-	struct razor_package_iterator *pi;
-	struct razor_package *package;
-	struct razor_package *package_retval = NULL;
-	const gchar *name, *version, *arch;
-
-	pi = razor_package_iterator_create (set);
-	while (razor_package_iterator_next (pi, &package,
-					    RAZOR_DETAIL_NAME, &name,
-					    RAZOR_DETAIL_VERSION, &version,
-					    RAZOR_DETAIL_ARCH, &arch,
-					    RAZOR_DETAIL_LAST)) {
-		if (g_strcmp0 (name, id->name) == 0) {
-			package_retval = package;
-			break;
-		}
-	}
-	razor_package_iterator_destroy (pi);
-	return package_retval;
-}
-
 /**
  * backend_get_files:
  */
@@ -233,17 +245,14 @@ backend_get_files (PkBackend *backend, gchar **package_ids)
 	guint length;
 	const gchar *package_id;
 	struct razor_package *package;
-	PkPackageId *id;
 
 	length = g_strv_length (package_ids);
 	for (i=0; i<length; i++) {
 		package_id = package_ids[i];
-		id = pk_package_id_new_from_string (package_id);
 		/* TODO: we need to get this list! */
-		package = backend_resolve_package_id (id);
+		package = backend_resolve_package_id (package_id);
 		razor_set_list_package_files (set, package);
 		pk_backend_files (backend, package_id, "/usr/bin/dave;/usr/share/brian");
-		pk_package_id_free (id);
 	}
 	pk_backend_finished (backend);
 }
@@ -253,16 +262,14 @@ backend_get_packages_thread (PkBackend *backend)
 {
 	struct razor_package_iterator *pi;
 	struct razor_package *package;
-	const gchar *name, *version, *arch, *summary;
+	const gchar *name, *summary;
 
 	pi = razor_package_iterator_create (set);
 	while (razor_package_iterator_next (pi, &package,
 					    RAZOR_DETAIL_NAME, &name,
-					    RAZOR_DETAIL_VERSION, &version,
-					    RAZOR_DETAIL_ARCH, &arch,
 					    RAZOR_DETAIL_SUMMARY, &summary,
 					    RAZOR_DETAIL_LAST)) {
-		pk_razor_emit_package (backend, name, version, arch, summary);
+		pk_razor_emit_package (backend, package, name, summary);
 	}
 
 	razor_package_iterator_destroy (pi);
@@ -318,7 +325,7 @@ backend_search_thread (PkBackend *backend)
 {
 	struct razor_package_iterator *pi;
 	struct razor_package *package;
-	const gchar *name, *version, *arch, *summary, *description;
+	const gchar *name, *summary, *description;
 	PkRazorSearchType type;
 	gboolean found;
 	const gchar *search;
@@ -329,8 +336,6 @@ backend_search_thread (PkBackend *backend)
 	pi = razor_package_iterator_create (set);
 	while (razor_package_iterator_next (pi, &package,
 					    RAZOR_DETAIL_NAME, &name,
-					    RAZOR_DETAIL_VERSION, &version,
-					    RAZOR_DETAIL_ARCH, &arch,
 					    RAZOR_DETAIL_SUMMARY, &summary,
 					    RAZOR_DETAIL_DESCRIPTION, &description,
 					    RAZOR_DETAIL_LAST)) {
@@ -338,7 +343,7 @@ backend_search_thread (PkBackend *backend)
 		/* find in the name */
 		found = pk_str_case_contains (name, search);
 		if (found) {
-			pk_razor_emit_package (backend, name, version, arch, summary);
+			pk_razor_emit_package (backend, package, name, summary);
 
 		/* look in summary and description if we are searching by description */
 		} else if (type == PK_RAZOR_SEARCH_TYPE_SUMMARY) {
@@ -347,7 +352,7 @@ backend_search_thread (PkBackend *backend)
 				found = pk_str_case_contains (description, search);
 			}
 			if (found) {
-				pk_razor_emit_package (backend, name, version, arch, summary);
+				pk_razor_emit_package (backend, package, name, summary);
 			}
 		}
 	}
@@ -37,7 +37,7 @@ struct category_map {
     PkGroupEnum group;
 };
 
-static struct category_map CATGROUP[] = { /* TODO: load into hashmap */
+static struct category_map CATGROUP[] = {
 /* Slackware */
 {          "a", PK_GROUP_ENUM_SYSTEM /* The base Slackware system. */ },
 {         "ap", PK_GROUP_ENUM_OTHER /* Linux applications. */ },
@@ -96,8 +96,21 @@ static struct category_map CATGROUP[] = { /* TODO: load into hashmap */
 {         NULL, PK_GROUP_ENUM_UNKNOWN }
 };
 
+/* package list with lookup tables, so queries don't scan the list */
+typedef struct {
+	slapt_pkg_list_t *pkgs;
+	GHashTable *by_version;	/* "name version" -> slapt_pkg_info_t */
+	GHashTable *by_name;	/* name -> GPtrArray of slapt_pkg_info_t */
+	GHashTable *by_group;	/* PkGroupEnum -> GPtrArray of slapt_pkg_info_t */
+	PkBackendPackageTable *ids;	/* slapt_pkg_info_t <-> package_id */
+} PkgIndex;
+
 static PkBackend *_backend = NULL;
 
+static GHashTable *_catgroup = NULL;
+static PkgIndex *_installed = NULL;
+static PkgIndex *_available = NULL;
+
 static slapt_rc_config *_config = NULL;
 static const gchar *_config_file = "/etc/slapt-get/slapt-getrc";
 
@@ -119,6 +132,176 @@ double dltotal, double dlnow, double ultotal, double ulnow)
 	return 0;
 }
 
+/* return the last item of the pkg->location, after the slash */
+static const char *_get_pkg_category(slapt_pkg_info_t *pkg)
+{
+	char *p;
+
+	p = strrchr(pkg->location, '/');
+	if (p == NULL)
+	    return "";
+	else
+	    return (const char *) p + 1;
+}
+
+/* map the category of the package to a group, using the CATGROUP table */
+static PkGroupEnum _get_pkg_group(slapt_pkg_info_t *pkg)
+{
+	gpointer group;
+
+	if (g_hash_table_lookup_extended(_catgroup, _get_pkg_category(pkg), NULL, &group))
+	    return GPOINTER_TO_INT(group);
+	return PK_GROUP_ENUM_UNKNOWN;
+}
+
+static PkPackageId* _get_id_from_pkg(slapt_pkg_info_t *pkg)
+{
+	PkPackageId *pi;
+	gchar **fields;
+	const gchar *version;
+	const char *data;
+
+	fields = g_strsplit(pkg->version, "-", 3);
+	version = g_strdup_printf("%s-%s", fields[0], fields[2]);
+	data = pkg->installed ? "installed" : "available"; /* TODO: source */
+	pi = pk_package_id_new_from_list(pkg->name, version, fields[1], data);
+	g_free((gpointer) version);
+	g_strfreev(fields);
+
+	return pi;
+}
+
+static const gchar* _get_string_from_pkg(slapt_pkg_info_t *pkg)
+{
+	PkPackageId *pi;
+	const gchar *package_id;
+
+	pi = _get_id_from_pkg(pkg);
+	if (pi == NULL)
+	    return NULL;
+	package_id = pk_package_id_to_string(pi);
+	pk_package_id_free(pi);
+	return package_id;
+}
+
+static void _pkg_index_append(GHashTable *table, gpointer key, slapt_pkg_info_t *pkg)
+{
+	GPtrArray *array;
+
+	array = g_hash_table_lookup(table, key);
+	if (array == NULL) {
+	    array = g_ptr_array_new();
+	    g_hash_table_insert(table, key, array);
+	}
+	g_ptr_array_add(array, pkg);
+}
+
+static PkgIndex* _pkg_index_new(slapt_pkg_list_t *pkgs)
+{
+	PkgIndex *index;
+	slapt_pkg_info_t *pkg;
+	const gchar *package_id;
+	gchar *key;
+	unsigned int i;
+
+	index = g_new0(PkgIndex, 1);
+	index->pkgs = pkgs;
+	index->by_version = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	index->by_name = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+	index->by_group = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+	index->ids = pk_backend_package_table_new();
+
+	for (i = 0; i < pkgs->pkg_count; i++) {
+	    pkg = pkgs->pkgs[i];
+
+	    /* like slapt_get_exact_pkg, the first match wins */
+	    key = g_strdup_printf("%s %s", pkg->name, pkg->version);
+	    if (g_hash_table_lookup(index->by_version, key) == NULL)
+		g_hash_table_insert(index->by_version, key, pkg);
+	    else
+		g_free(key);
+	    _pkg_index_append(index->by_name, pkg->name, pkg);
+	    _pkg_index_append(index->by_group, GINT_TO_POINTER(_get_pkg_group(pkg)), pkg);
+
+	    /* build the package_id once, not for every result sent */
+	    package_id = _get_string_from_pkg(pkg);
+	    if (package_id != NULL)
+		pk_backend_package_table_add(index->ids, pkg, package_id);
+	    g_free((gpointer) package_id);
+	}
+
+	return index;
+}
+
+static void _pkg_index_free(PkgIndex *index)
+{
+	if (index == NULL)
+	    return;
+	pk_backend_package_table_free(index->ids);
+	g_hash_table_destroy(index->by_group);
+	g_hash_table_destroy(index->by_name);
+	g_hash_table_destroy(index->by_version);
+	slapt_free_pkg_list(index->pkgs);
+	g_free(index);
+}
+
+static slapt_pkg_info_t* _pkg_index_get_exact(PkgIndex *index, const gchar *name, const gchar *version)
+{
+	slapt_pkg_info_t *pkg;
+	gchar *key;
+
+	key = g_strdup_printf("%s %s", name, version);
+	pkg = g_hash_table_lookup(index->by_version, key);
+	g_free(key);
+
+	return pkg;
+}
+
+/* like slapt_get_newest_pkg, but only looking at the pkgs with this name */
+static slapt_pkg_info_t* _pkg_index_get_newest(PkgIndex *index, const gchar *name)
+{
+	GPtrArray *array;
+	slapt_pkg_info_t *pkg;
+	slapt_pkg_info_t *newest = NULL;
+	guint i;
+
+	array = g_hash_table_lookup(index->by_name, name);
+	for (i = 0; array != NULL && i < array->len; i++) {
+	    pkg = g_ptr_array_index(array, i);
+	    if (newest == NULL || slapt_cmp_pkgs(newest, pkg) < 0)
+		newest = pkg;
+	}
+
+	return newest;
+}
+
+/* the package_id of a pkg in the index, owned by the index */
+static const gchar* _pkg_index_get_id(PkgIndex *index, slapt_pkg_info_t *pkg)
+{
+	return pk_backend_package_table_get_id(index->ids, pkg);
+}
+
+/* the pkg with exactly this package_id in either index, or NULL */
+static slapt_pkg_info_t* _pkg_index_lookup(const gchar *package_id)
+{
+	slapt_pkg_info_t *pkg;
+
+	pkg = pk_backend_package_table_lookup(_available->ids, package_id);
+	if (pkg == NULL)
+	    pkg = pk_backend_package_table_lookup(_installed->ids, package_id);
+	return pkg;
+}
+
+/* (re)load the installed and available lists, e.g. after RefreshCache */
+static void _load_pkg_indexes(void)
+{
+	_pkg_index_free(_installed);
+	_pkg_index_free(_available);
+
+	_installed = _pkg_index_new(slapt_get_installed_pkgs());
+	_available = _pkg_index_new(slapt_get_available_pkgs());
+}
+
 /**
  * backend_initialize:
  * This should only be run once per backend load, i.e. not every transaction
@@ -126,6 +309,8 @@ double dltotal, double dlnow, double ultotal, double ulnow)
 static void
 backend_initialize (PkBackend *backend)
 {
+	struct category_map *catgroup;
+
 	_config = slapt_read_rc_config(_config_file);
 	if (_config == NULL)
 	    _config = slapt_init_config();
@@ -135,6 +320,17 @@ backend_initialize (PkBackend *backend)
 	    _config->progress_cb = &backend_progress_callback;
 
 	chdir(_config->working_dir);
+
+	_catgroup = g_hash_table_new(g_str_hash, g_str_equal);
+	for (catgroup = CATGROUP; catgroup->category != NULL; catgroup++) {
+	    /* some categories are listed twice, the first one wins */
+	    if (g_hash_table_lookup_extended(_catgroup, catgroup->category, NULL, NULL))
+		continue;
+	    g_hash_table_insert(_catgroup, (gpointer) catgroup->category,
+	                        GINT_TO_POINTER(catgroup->group));
+	}
+
+	_load_pkg_indexes();
 }
 
 /**
@@ -144,6 +340,10 @@ backend_initialize (PkBackend *backend)
 static void
 backend_destroy (PkBackend *backend)
 {
+	_pkg_index_free(_available);
+	_pkg_index_free(_installed);
+	g_hash_table_destroy(_catgroup);
+
 	slapt_free_rc_config(_config);
 }
 
@@ -258,46 +458,23 @@ static slapt_pkg_info_t* _get_pkg_from_string(const gchar *package_id,
 	return pkg;
 }
 
-static PkPackageId* _get_id_from_pkg(slapt_pkg_info_t *pkg)
+/* like _get_pkg_from_id, but using the prebuilt lookup tables */
+static slapt_pkg_info_t* _get_indexed_pkg_from_id(PkPackageId *pi)
 {
-	PkPackageId *pi;
+	slapt_pkg_info_t *pkg;
 	gchar **fields;
 	const gchar *version;
-	const char *data;
 
-	fields = g_strsplit(pkg->version, "-", 3);
-	version = g_strdup_printf("%s-%s", fields[0], fields[2]);
-	data = pkg->installed ? "installed" : "available"; /* TODO: source */
-	pi = pk_package_id_new_from_list(pkg->name, version, fields[1], data);
+	fields = g_strsplit(pi->version, "-", 2);
+	version = g_strdup_printf("%s-%s-%s", fields[0], pi->arch, fields[1]);
+	pkg = _pkg_index_get_exact(_available, pi->name, version);
+	if (pkg == NULL) {
+		pkg = _pkg_index_get_exact(_installed, pi->name, version);
+	}
 	g_free((gpointer) version);
 	g_strfreev(fields);
 
-	return pi;
-}
-
-static const gchar* _get_string_from_pkg(slapt_pkg_info_t *pkg)
-{
-	PkPackageId *pi;
-	const gchar *package_id;
-
-	pi = _get_id_from_pkg(pkg);
-	if (pi == NULL)
-	    return NULL;
-	package_id = pk_package_id_to_string(pi);
-	pk_package_id_free(pi);
-	return package_id;
-}
-
-/* return the last item of the pkg->location, after the slash */
-static const char *_get_pkg_category(slapt_pkg_info_t *pkg)
-{
-	char *p;
-
-	p = strrchr(pkg->location, '/');
-	if (p == NULL)
-	    return "";
-	else
-	    return (const char *) p + 1;
+	return pkg;
 }
 
 /* return the first line of the pkg->description, without the prefix */
@@ -432,42 +609,32 @@ backend_get_details (PkBackend *backend, gchar **package_ids)
 	const gchar *description;
 	PkGroupEnum group;
 
-	slapt_pkg_list_t *installed;
-	slapt_pkg_list_t *available;
 	slapt_pkg_info_t *pkg;
-	const char *category;
-	struct category_map *catgroup;
 
 	pk_backend_set_status (backend, PK_STATUS_ENUM_QUERY);
 	pk_backend_set_percentage (backend, 0);
 
-	installed = slapt_get_installed_pkgs();
-	available = slapt_get_available_pkgs();
-
 	len = g_strv_length (package_ids);
 	for (i=0; i<len; i++) {
 	    package_id = package_ids[i];
-	    pi = pk_package_id_new_from_string (package_id);
-	    if (pi == NULL) {
-		pk_backend_error_code (backend, PK_ERROR_ENUM_PACKAGE_ID_INVALID, "invalid package id");
-		pk_backend_finished (backend);
-		return;
+	    pkg = _pkg_index_lookup(package_id);
+	    if (pkg == NULL) {
+		/* the data field may not match, so fall back to name and version */
+		pi = pk_package_id_new_from_string (package_id);
+		if (pi == NULL) {
+		    pk_backend_error_code (backend, PK_ERROR_ENUM_PACKAGE_ID_INVALID, "invalid package id");
+		    pk_backend_finished (backend);
+		    return;
+		}
+		pkg = _get_indexed_pkg_from_id(pi);
+		pk_package_id_free (pi);
 	    }
-	    pkg = _get_pkg_from_id(pi, available, installed);
-	    pk_package_id_free (pi);
 	    if (pkg == NULL) {
 		pk_backend_error_code (backend, PK_ERROR_ENUM_PACKAGE_NOT_FOUND, "package not found");
 		continue;
 	    }
 
-	    category = _get_pkg_category(pkg);
-	    group = PK_GROUP_ENUM_UNKNOWN;
-	    for (catgroup = CATGROUP; catgroup->category != NULL; catgroup++) {
-		if (strcmp(catgroup->category, category) == 0) {
-		    group = catgroup->group;
-		    break;
-		}
-	    }
+	    group = _get_pkg_group(pkg);
 
 	    description = g_strstrip((gchar*) _get_pkg_description(pkg));
 
@@ -477,9 +644,6 @@ backend_get_details (PkBackend *backend, gchar **package_ids)
 	    g_free((gpointer) description);
 	}
 
-	slapt_free_pkg_list(available);
-	slapt_free_pkg_list(installed);
-
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -632,11 +796,8 @@ static void
 backend_get_updates (PkBackend *backend, PkBitfield filters)
 {
 	guint i;
-	const gchar *package_id;
 	const gchar *new_package_id;
 
-	slapt_pkg_list_t *installed;
-	slapt_pkg_list_t *available;
 	slapt_pkg_info_t *pkg;
 	slapt_pkg_info_t *newpkg;
 	const gchar *summary;
@@ -646,19 +807,15 @@ backend_get_updates (PkBackend *backend, PkBitfield filters)
 	pk_backend_set_status (backend, PK_STATUS_ENUM_QUERY);
 	pk_backend_set_percentage (backend, 0);
 
-	installed = slapt_get_installed_pkgs();
-	available = slapt_get_available_pkgs();
-
-	for (i = 0; i < installed->pkg_count; i++) {
-	    pkg = installed->pkgs[i];
-	    newpkg = slapt_get_newest_pkg(available, pkg->name);
+	for (i = 0; i < _installed->pkgs->pkg_count; i++) {
+	    pkg = _installed->pkgs->pkgs[i];
+	    newpkg = _pkg_index_get_newest(_available, pkg->name);
 	    if (newpkg == NULL)
 		continue;
 	    if (slapt_cmp_pkgs(pkg,newpkg) >= 0)
 		continue;
 
-	    package_id = _get_string_from_pkg(pkg);
-	    new_package_id = _get_string_from_pkg(newpkg);
+	    new_package_id = _pkg_index_get_id(_available, newpkg);
 
 	    changelog = slapt_get_pkg_changelog(newpkg);
 	    if (changelog != NULL &&
@@ -671,13 +828,8 @@ backend_get_updates (PkBackend *backend, PkBitfield filters)
 	    pk_backend_package (backend, state,
 	                        new_package_id, summary);
 	    g_free((gpointer) summary);
-	    g_free((gpointer) new_package_id);
-	    g_free((gpointer) package_id);
 	}
 
-	slapt_free_pkg_list(available);
-	slapt_free_pkg_list(installed);
-
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -745,6 +897,9 @@ backend_install_packages (PkBackend *backend, gboolean only_trusted, gchar **pac
 	slapt_free_pkg_list(available);
 	slapt_free_pkg_list(installed);
 
+	/* the set of installed packages has changed */
+	_load_pkg_indexes();
+
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -758,6 +913,7 @@ backend_refresh_cache (PkBackend *backend, gboolean force)
 	pk_backend_set_allow_cancel (backend, TRUE);
 	pk_backend_set_status (backend, PK_STATUS_ENUM_REFRESH_CACHE);
 	slapt_update_pkg_cache(_config);
+	_load_pkg_indexes();
 	pk_backend_finished (backend);
 }
 
@@ -768,54 +924,47 @@ static void
 backend_resolve (PkBackend *backend, PkBitfield filters, gchar **packages)
 {
 	guint i;
+	guint j;
 	guint len;
 
 	const gchar *package_id;
-	slapt_pkg_list_t *pkglist;
+	PkgIndex *index;
 	slapt_pkg_info_t *pkg = NULL;
-	slapt_pkg_list_t *results = NULL;
+	GPtrArray *results = NULL;
 
 	PkInfoEnum state;
-	const gchar *search;
 	const char *summary;
 
 	pk_backend_set_status (backend, PK_STATUS_ENUM_QUERY);
 	pk_backend_set_percentage (backend, 0);
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)) {
-		pkglist = slapt_get_installed_pkgs();
+		index = _installed;
 		state = PK_INFO_ENUM_INSTALLED;
 	} else {
-		pkglist = slapt_get_available_pkgs();
+		index = _available;
 		state = PK_INFO_ENUM_AVAILABLE;
 	}
 
 	len = g_strv_length (packages);
 	for (i=0; i<len; i++) {
 
-		search = g_strdup_printf("^%s$", packages[i]); /* regexp */
-		results = slapt_search_pkg_list(pkglist, search);
-		g_free((gpointer) search);
+		results = g_hash_table_lookup(index->by_name, packages[i]);
 		if (results == NULL) {
 		    pk_backend_error_code (backend, PK_ERROR_ENUM_PACKAGE_NOT_FOUND, "package not found");
 		    continue;
 		}
 
-		for (i = 0; i < results->pkg_count; i++) {
-			pkg = results->pkgs[i];
+		for (j = 0; j < results->len; j++) {
+			pkg = g_ptr_array_index(results, j);
 
-			package_id = _get_string_from_pkg(pkg);
+			package_id = _pkg_index_get_id(index, pkg);
 			summary = _get_pkg_summary(pkg);
 			pk_backend_package (backend, state, package_id, summary);
 			g_free((gpointer) summary);
-			g_free((gpointer) package_id);
 		}
-
-		slapt_free_pkg_list(results);
 	}
 
-	slapt_free_pkg_list(pkglist);
-
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -883,6 +1032,9 @@ backend_remove_packages (PkBackend *backend, gchar **package_ids, gboolean allow
 	slapt_free_pkg_list(available);
 	slapt_free_pkg_list(installed);
 
+	/* the set of installed packages has changed */
+	_load_pkg_indexes();
+
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -896,7 +1048,7 @@ backend_search_details (PkBackend *backend, PkBitfield filters, const gchar *sea
 	guint i;
 
 	const gchar *package_id;
-	slapt_pkg_list_t *pkglist;
+	PkgIndex *index;
 	slapt_pkg_info_t *pkg = NULL;
 	slapt_pkg_list_t *results = NULL;
 
@@ -907,28 +1059,25 @@ backend_search_details (PkBackend *backend, PkBitfield filters, const gchar *sea
 	pk_backend_set_percentage (backend, 0);
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)) {
-		pkglist = slapt_get_installed_pkgs();
+		index = _installed;
 		state = PK_INFO_ENUM_INSTALLED;
 	} else {
-		pkglist = slapt_get_available_pkgs();
+		index = _available;
 		state = PK_INFO_ENUM_AVAILABLE;
 	}
 
-		results = slapt_search_pkg_list(pkglist, search);
+		results = slapt_search_pkg_list(index->pkgs, search);
 		for (i = 0; i < results->pkg_count; i++) {
 			pkg = results->pkgs[i];
 
-			package_id = _get_string_from_pkg(pkg);
+			package_id = _pkg_index_get_id(index, pkg);
 			summary = _get_pkg_summary(pkg);
 			pk_backend_package (backend, state, package_id, summary);
 			g_free((gpointer) summary);
-			g_free((gpointer) package_id);
 		}
 
 		slapt_free_pkg_list(results);
 
-	slapt_free_pkg_list(pkglist);
-
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -942,12 +1091,10 @@ backend_search_group (PkBackend *backend, PkBitfield filters, const gchar *searc
 	guint i;
 
 	const gchar *package_id;
-	slapt_pkg_list_t *pkglist;
+	PkgIndex *index;
+	GPtrArray *results;
 	slapt_pkg_info_t *pkg = NULL;
-	PkGroupEnum group;
 	PkGroupEnum search_group;
-	const char *category;
-	struct category_map *catgroup;
 
 	PkInfoEnum state;
 	const char *summary;
@@ -956,40 +1103,25 @@ backend_search_group (PkBackend *backend, PkBitfield filters, const gchar *searc
 	pk_backend_set_percentage (backend, 0);
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)) {
-		pkglist = slapt_get_installed_pkgs();
+		index = _installed;
 		state = PK_INFO_ENUM_INSTALLED;
 	} else {
-		pkglist = slapt_get_available_pkgs();
+		index = _available;
 		state = PK_INFO_ENUM_AVAILABLE;
 	}
 
 	search_group = pk_group_enum_from_string(search);
 
-	for (i = 0; i < pkglist->pkg_count; i++) {
-		pkg = pkglist->pkgs[i];
-
-		category = _get_pkg_category(pkg);
-		    group = PK_GROUP_ENUM_UNKNOWN;
-		    for (catgroup = CATGROUP; catgroup->category != NULL; catgroup++) {
-			if (strcmp(catgroup->category, category) == 0) {
-			    group = catgroup->group;
-			    break;
-			}
-		    }
-
-		if (group == search_group) {
-
-			package_id = _get_string_from_pkg(pkg);
-			summary = _get_pkg_summary(pkg);
-			pk_backend_package (backend, state, package_id, summary);
-			g_free((gpointer) summary);
-			g_free((gpointer) package_id);
+	results = g_hash_table_lookup(index->by_group, GINT_TO_POINTER(search_group));
+	for (i = 0; results != NULL && i < results->len; i++) {
+		pkg = g_ptr_array_index(results, i);
 
-		}
+		package_id = _pkg_index_get_id(index, pkg);
+		summary = _get_pkg_summary(pkg);
+		pk_backend_package (backend, state, package_id, summary);
+		g_free((gpointer) summary);
 	}
 
-	slapt_free_pkg_list(pkglist);
-
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -1003,7 +1135,7 @@ backend_search_name (PkBackend *backend, PkBitfield filters, const gchar *search
 	unsigned int i;
 
 	const gchar *package_id;
-	slapt_pkg_list_t *pkglist;
+	PkgIndex *index;
 	slapt_pkg_info_t *pkg = NULL;
 	slapt_pkg_list_t *results = NULL;
 
@@ -1014,14 +1146,14 @@ backend_search_name (PkBackend *backend, PkBitfield filters, const gchar *search
 	pk_backend_set_percentage (backend, 0);
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)) {
-		pkglist = slapt_get_installed_pkgs();
+		index = _installed;
 		state = PK_INFO_ENUM_INSTALLED;
 	} else {
-		pkglist = slapt_get_available_pkgs();
+		index = _available;
 		state = PK_INFO_ENUM_AVAILABLE;
 	}
 
-		results = slapt_search_pkg_list(pkglist, search);
+		results = slapt_search_pkg_list(index->pkgs, search);
 		g_free((gpointer) search);
 		if (results == NULL) {
 		    pk_backend_error_code (backend, PK_ERROR_ENUM_PACKAGE_NOT_FOUND, "package not found");
@@ -1031,18 +1163,15 @@ backend_search_name (PkBackend *backend, PkBitfield filters, const gchar *search
 		for (i = 0; i < results->pkg_count; i++) {
 			pkg = results->pkgs[i];
 
-			package_id = _get_string_from_pkg(pkg);
+			package_id = _pkg_index_get_id(index, pkg);
 			summary = _get_pkg_summary(pkg);
 			pk_backend_package (backend, state, package_id, summary);
 			g_free((gpointer) summary);
-			g_free((gpointer) package_id);
 		}
 
 		slapt_free_pkg_list(results);
 
 out:
-	slapt_free_pkg_list(pkglist);
-
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -1107,6 +1236,9 @@ backend_update_packages (PkBackend *backend, gboolean only_trusted, gchar **pack
 	slapt_free_pkg_list(available);
 	slapt_free_pkg_list(installed);
 
+	/* the set of installed packages has changed */
+	_load_pkg_indexes();
+
 	pk_backend_set_percentage (backend, 100);
 	pk_backend_finished (backend);
 }
@@ -1200,35 +1332,31 @@ backend_get_packages (PkBackend *backend, PkBitfield filters)
 	};
 	PkFilterEnum *list_filter;
 
+	PkgIndex *index;
 	slapt_pkg_list_t *pkglist;
 	slapt_pkg_info_t *pkg;
 	slapt_pkg_info_t *other_pkg;
 	unsigned int i;
 	const gchar *package_id;
 
-	slapt_pkg_list_t *installed;
-	slapt_pkg_list_t *available;
-
 	PkInfoEnum state;
 	const char *summary;
 
-	installed = slapt_get_installed_pkgs();
-	available = slapt_get_available_pkgs();
-
 	pk_backend_set_status (backend, PK_STATUS_ENUM_REQUEST);
 	for (list_filter = list_order; *list_filter != PK_FILTER_ENUM_UNKNOWN; list_filter++) {
 
 	    if (*list_filter == PK_FILTER_ENUM_INSTALLED) {
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED))
 		    break;
-		pkglist = installed;
+		index = _installed;
 	    } else if (*list_filter == PK_FILTER_ENUM_NOT_INSTALLED) {
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED))
 		    break;
-		pkglist = available;
+		index = _available;
 	    } else {
 		continue;
 	    }
+	    pkglist = index->pkgs;
 
 	    for (i = 0; i < pkglist->pkg_count; i++) {
 		pkg = pkglist->pkgs[i];
@@ -1236,8 +1364,8 @@ backend_get_packages (PkBackend *backend, PkBitfield filters)
 		/* check so that we don't show installed pkgs twice */
 		if (*list_filter == PK_FILTER_ENUM_NOT_INSTALLED &&
 		    !pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
-		    other_pkg = slapt_get_exact_pkg(installed,
-		                                    pkg->name, pkg->version);
+		    other_pkg = _pkg_index_get_exact(_installed,
+		                                     pkg->name, pkg->version);
 		    if (other_pkg != NULL) {
 			continue;
 		    }
@@ -1245,25 +1373,21 @@ backend_get_packages (PkBackend *backend, PkBitfield filters)
 
 		/* only display the newest pkg in each pkglist */
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NEWEST)) {
-		    other_pkg = slapt_get_newest_pkg(pkglist, pkg->name);
+		    other_pkg = _pkg_index_get_newest(index, pkg->name);
 		    if (slapt_cmp_pkgs(pkg, other_pkg) <= 0) {
 			continue;
 		    }
 		}
 
 		state = pkg->installed ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE;
-		package_id = _get_string_from_pkg(pkg);
+		package_id = _pkg_index_get_id(index, pkg);
 		summary = _get_pkg_summary(pkg);
 		pk_backend_package (backend, state, package_id, summary);
 		g_free((gpointer) summary);
-		g_free((gpointer) package_id);
 	    }
 
 	}
 
-	slapt_free_pkg_list(available);
-	slapt_free_pkg_list(installed);
-
 	pk_backend_finished (backend);
 }
 
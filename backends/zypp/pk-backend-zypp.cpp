@@ -592,6 +592,9 @@ static gboolean
 backend_refresh_cache_thread (PkBackend *backend)
 {
 	gboolean force = pk_backend_get_bool(backend, "force");
+
+	// the repos that have been refreshed are kept if we stop early
+	pk_backend_set_allow_cancel (backend, TRUE);
 	zypp_refresh_cache (backend, force);
 	pk_backend_finished (backend);
 	return TRUE;
@@ -1338,12 +1341,12 @@ backend_find_packages_thread (PkBackend *backend)
 		// did not search in srcpackages.
 		break;
 	case SEARCH_TYPE_FILE: {
-		// zypp_build_pool (TRUE); called by zypp_get_packages_by_file
+		// zypp_build_pool (TRUE); called by zypp_get_packages_by_files
 		std::vector<zypp::sat::Solvable> *r;
-		r = zypp_get_packages_by_file (backend, search);
+		r = zypp_get_packages_by_files (backend, values);
 		v.swap( *r );
 		delete r;
-		// zypp_get_packages_by_file does strange things :)
+		// zypp_get_packages_by_files does strange things :)
 		// Maybe it would be sufficient to simply query
 		// zypp::sat::SolvAttr::filelist instead?
 		break;
@@ -1872,6 +1875,17 @@ backend_what_provides (PkBackend *backend, PkBitfield filters, PkProvidesEnum pr
 	pk_backend_thread_create (backend, backend_what_provides_thread);
 }
 
+/**
+ * backend_cancel:
+ *
+ * Only RefreshCache allows cancelling, and it stops before the next repo
+ */
+static void
+backend_cancel (PkBackend *backend)
+{
+	pk_backend_set_status (backend, PK_STATUS_ENUM_CANCEL);
+}
+
 static gchar *
 backend_get_mime_types (PkBackend *backend)
 {
@@ -1930,7 +1944,7 @@ extern "C" PK_BACKEND_OPTIONS (
 	backend_get_filters,			/* get_filters */
 	NULL,					/* get_roles */
 	backend_get_mime_types,			/* get_mime_types */
-	NULL,					/* cancel */
+	backend_cancel,				/* cancel */
 	NULL,					/* download_packages */
 	NULL,					/* get_categories */
 	backend_get_depends,			/* get_depends */
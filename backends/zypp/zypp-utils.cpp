@@ -49,6 +49,8 @@
 #include <zypp/target/rpm/librpmDb.h>
 #include <zypp/base/LogControl.h>
 #include <zypp/base/String.h>
+#include <zypp/base/SerialNumber.h>
+#include <zypp/base/Tr1hash.h>
 
 #include <zypp/base/Logger.h>
 
@@ -60,6 +62,39 @@
 
 gchar * _repoName;
 gboolean _updating_self = FALSE;
+
+/**
+ * Resolved package_ids, only valid as long as the pool doesn't change
+ */
+static std::tr1::unordered_map<std::string, zypp::sat::Solvable> _package_id_cache;
+static zypp::SerialNumberWatcher _package_id_cache_serial;
+
+/**
+ * Owners of files found in the rpmdb, only valid as long as neither
+ * the rpmdb nor the pool change
+ */
+static std::tr1::unordered_map<std::string, std::vector<zypp::sat::Solvable> > _file_owner_cache;
+static zypp::SerialNumberWatcher _file_owner_cache_serial;
+static time_t _file_owner_cache_mtime = 0;
+
+/**
+ * Result of zypp_get_updates, only valid as long as neither the
+ * rpmdb nor the pool change
+ */
+static std::set<zypp::PoolItem> _updates_cache;
+static gboolean _updates_cache_updating_self = FALSE;
+static gboolean _updates_cache_valid = FALSE;
+static zypp::SerialNumberWatcher _updates_cache_serial;
+static time_t _updates_cache_mtime = 0;
+
+/**
+ * What the resolver decided for the last simulated transaction, the real
+ * transaction that follows reuses it if nothing changed in between
+ */
+static std::vector<std::pair<zypp::PoolItem, zypp::ResStatus> > _plan_cache;
+static gchar *_plan_cache_key = NULL;
+static zypp::SerialNumberWatcher _plan_cache_serial;
+static time_t _plan_cache_mtime = 0;
 /**
  * Collect items, select best edition.  This is used to find the best
  * available or installed.  The name of the class is a bit misleading though ...
@@ -351,31 +386,69 @@ zypp_get_packages_by_name (PkBackend *backend, const gchar *package_name,
 	return v;
 }
 
+static time_t
+zypp_get_rpmdb_mtime (PkBackend *backend)
+{
+	struct stat buffer;
+	time_t mtime = 0;
+	gchar *filename = g_build_filename (pk_backend_get_root (backend), "var", "lib", "rpm", "Packages", NULL);
+
+	if (g_stat (filename, &buffer) == 0)
+		mtime = buffer.st_mtime;
+
+	g_free (filename);
+	return mtime;
+}
+
 std::vector<zypp::sat::Solvable> *
-zypp_get_packages_by_file (PkBackend *backend, const gchar *search_file)
+zypp_get_packages_by_files (PkBackend *backend, gchar **search_files)
 {
-        std::vector<zypp::sat::Solvable> *v = new std::vector<zypp::sat::Solvable> ();
+	std::vector<zypp::sat::Solvable> *v = new std::vector<zypp::sat::Solvable> ();
+	std::set<zypp::sat::Solvable> seen;
 
-        zypp::ResPool pool = zypp_build_pool (backend, TRUE);
+	zypp::ResPool pool = zypp_build_pool (backend, TRUE);
 
-        std::string file (search_file);
+	// forget everything we found for an older rpmdb or pool
+	time_t mtime = zypp_get_rpmdb_mtime (backend);
+	if (_file_owner_cache_serial.remember (pool.serial ()) || mtime != _file_owner_cache_mtime) {
+		_file_owner_cache.clear ();
+		_file_owner_cache_mtime = mtime;
+	}
 
+	// the rpmdb is only opened once for all the files
 	zypp::target::rpm::librpmDb::db_const_iterator it;
-	zypp::target::rpm::RpmHeader::constPtr result = new zypp::target::rpm::RpmHeader ();
 
-	for (it.findByFile (search_file); *it; ++it) {
-		for (zypp::ResPool::byName_iterator it2 = pool.byNameBegin (it->tag_name ()); it2 != pool.byNameEnd (it->tag_name ()); it2++) {
-			if ((*it2)->isSystem ())
-				v->push_back ((*it2)->satSolvable ());
-		}
-	}
+	for (guint i = 0; search_files[i] != NULL; i++) {
+		std::string file (search_files[i]);
+		std::tr1::unordered_map<std::string, std::vector<zypp::sat::Solvable> >::iterator cached = _file_owner_cache.find (file);
 
-	if (v->empty ()) {
-		zypp::Capability cap (search_file);
-		zypp::sat::WhatProvides prov (cap);
+		if (cached == _file_owner_cache.end ()) {
+			std::vector<zypp::sat::Solvable> owners;
 
-		for(zypp::sat::WhatProvides::const_iterator it = prov.begin (); it != prov.end (); it++) {
-			v->push_back (*it);
+			for (it.findByFile (file); *it; ++it) {
+				for (zypp::ResPool::byName_iterator it2 = pool.byNameBegin (it->tag_name ()); it2 != pool.byNameEnd (it->tag_name ()); it2++) {
+					if ((*it2)->isSystem ())
+						owners.push_back ((*it2)->satSolvable ());
+				}
+			}
+
+			if (owners.empty ()) {
+				zypp::Capability cap (file);
+				zypp::sat::WhatProvides prov (cap);
+
+				for (zypp::sat::WhatProvides::const_iterator it2 = prov.begin (); it2 != prov.end (); it2++) {
+					owners.push_back (*it2);
+				}
+			}
+
+			cached = _file_owner_cache.insert (std::make_pair (file, owners)).first;
+		}
+
+		// a package owning several of the files is only returned once
+		for (std::vector<zypp::sat::Solvable>::const_iterator owner = cached->second.begin ();
+				owner != cached->second.end (); owner++) {
+			if (seen.insert (*owner).second)
+				v->push_back (*owner);
 		}
 	}
 
@@ -390,28 +463,34 @@ zypp_get_package_by_id (PkBackend *backend, const gchar *package_id)
 		return zypp::sat::Solvable::noSolvable;
 	}
 
-	gchar **id_parts = pk_package_id_split(package_id);
-	std::vector<zypp::sat::Solvable> *v = zypp_get_packages_by_name (backend, id_parts[PK_PACKAGE_ID_NAME], zypp::ResKind::package);
-	std::vector<zypp::sat::Solvable> *v2 = zypp_get_packages_by_name (backend, id_parts[PK_PACKAGE_ID_NAME], zypp::ResKind::patch);
+	zypp::ResPool pool = zypp_build_pool (backend, TRUE);
 
-	v->insert (v->end (), v2->begin (), v2->end ());
+	// forget everything we resolved for an older pool
+	if (_package_id_cache_serial.remember (pool.serial ()))
+		_package_id_cache.clear ();
 
-	if (v == NULL)
-		return zypp::sat::Solvable::noSolvable;
+	std::string key (package_id);
+	std::tr1::unordered_map<std::string, zypp::sat::Solvable>::const_iterator cached = _package_id_cache.find (key);
+	if (cached != _package_id_cache.end ())
+		return cached->second;
 
+	gchar **id_parts = pk_package_id_split(package_id);
+	const zypp::ResKind kinds[] = { zypp::ResKind::package, zypp::ResKind::patch };
 	zypp::sat::Solvable package;
 
-	for (std::vector<zypp::sat::Solvable>::iterator it = v->begin ();
-			it != v->end (); it++) {
-		if (zypp_ver_and_arch_equal (*it, id_parts[PK_PACKAGE_ID_VERSION],
-					     id_parts[PK_PACKAGE_ID_ARCH])) {
-			package = *it;
-			break;
+	for (guint i = 0; i < G_N_ELEMENTS (kinds) && !package; i++) {
+		for (zypp::ResPool::byIdent_iterator it = pool.byIdentBegin (kinds[i], id_parts[PK_PACKAGE_ID_NAME]);
+				it != pool.byIdentEnd (kinds[i], id_parts[PK_PACKAGE_ID_NAME]); it++) {
+			if (zypp_ver_and_arch_equal (it->satSolvable (), id_parts[PK_PACKAGE_ID_VERSION],
+						     id_parts[PK_PACKAGE_ID_ARCH])) {
+				package = it->satSolvable ();
+				break;
+			}
 		}
 	}
 
-	delete (v);
-	delete (v2);
+	_package_id_cache[key] = package;
+
 	g_strfreev (id_parts);
 	return package;
 }
@@ -454,18 +533,23 @@ class AbortTransactionException {
 gboolean
 zypp_refresh_meta_and_cache (zypp::RepoManager &manager, zypp::RepoInfo &repo, bool force)
 {
+	// a forced refresh always asks the server, otherwise a repo that was
+	// checked within its refresh delay is not contacted at all; either
+	// way only the checksum of the index is fetched when nothing changed
+	zypp::RepoManager::RawMetadataRefreshPolicy policy = force ?
+		zypp::RepoManager::RefreshIfNeededIgnoreDelay :
+		zypp::RepoManager::RefreshIfNeeded;
+
 	try {
-		if (manager.checkIfToRefreshMetadata (repo, repo.url(), 
-					zypp::RepoManager::RefreshIfNeededIgnoreDelay)
+		if (manager.checkIfToRefreshMetadata (repo, repo.url(), policy)
 					!= zypp::RepoManager::REFRESH_NEEDED)
 			return TRUE;
 
+		manager.refreshMetadata (repo, policy);
+
+		// Erase old solv file, only once we have the new metadata
 		zypp::sat::Pool pool = zypp::sat::Pool::instance ();
-		// Erase old solv file
 		pool.reposErase (repo.alias ());
-		manager.refreshMetadata (repo, force ?
-					 zypp::RepoManager::RefreshForced :
-					 zypp::RepoManager::RefreshIfNeededIgnoreDelay);
 		manager.buildCache (repo, force ?
 				    zypp::RepoManager::BuildForced :
 				    zypp::RepoManager::BuildIfNeeded);
@@ -714,30 +798,53 @@ zypp_find_arch_update_item (const zypp::ResPool & pool, zypp::PoolItem item)
 /**
  * Returns a set of all packages the could be updated
  * (you're able to exclude a single (normally the 'patch' repo)
+ *
+ * This gives the same result as calling zypp_find_arch_update_item for
+ * every installed package, but only walks the pool once.
  */
 static std::set<zypp::PoolItem> *
 zypp_get_package_updates (std::string repo)
 {
         std::set<zypp::PoolItem> *pks = new std::set<zypp::PoolItem> ();
         zypp::ResPool pool = zypp::ResPool::instance ();
+	std::vector<zypp::PoolItem> installed;
+	// best unlocked, uninstalled item for each name and arch
+	std::tr1::unordered_map<guint64, zypp::PoolItem> best;
 
         zypp::ResObject::Kind kind = zypp::ResTraits<zypp::Package>::kind;
         zypp::ResPool::byKind_iterator it = pool.byKindBegin (kind);
         zypp::ResPool::byKind_iterator e = pool.byKindEnd (kind);
 
         for (; it != e; ++it) {
-                if (it->status ().isUninstalled ())
-                        continue;
-                zypp::PoolItem candidate =  zypp_find_arch_update_item (pool, *it);
-                if (!candidate.resolvable ())
+                if (!it->status ().isUninstalled ()) {
+			installed.push_back (*it);
                         continue;
+		}
+		if (it->status ().isLocked ())
+			continue;
+
+		guint64 key = ((guint64) (*it)->ident ().id () << 32) | (guint32) (*it)->arch ().idStr ().id ();
+		zypp::PoolItem &b = best[key];
+		if (!b || b->edition ().compare ((*it)->edition ()) < 0)
+			b = *it;
+        }
+
+	for (std::vector<zypp::PoolItem>::const_iterator ii = installed.begin (); ii != installed.end (); ++ii) {
+		guint64 key = ((guint64) (*ii)->ident ().id () << 32) | (guint32) (*ii)->arch ().idStr ().id ();
+		std::tr1::unordered_map<guint64, zypp::PoolItem>::const_iterator found = best.find (key);
+		if (found == best.end ())
+			continue;
+
+		zypp::PoolItem candidate = found->second;
+		if (candidate->edition ().compare ((*ii)->edition ()) <= 0)
+			continue;
 		if (repo.empty ()) {
 	                pks->insert (candidate);
 		} else {
 			if (candidate->repoInfo ().alias ().compare (repo) != 0)
 				pks->insert (candidate);
 		}
-        }
+	}
 
         return pks;
 }
@@ -787,6 +894,16 @@ zypp_get_updates (PkBackend *backend)
 {
 	typedef std::set<zypp::PoolItem>::iterator pi_it_t;
 
+	// the updates only change when the pool or the rpmdb do
+	zypp::ResPool pool = zypp::ResPool::instance ();
+	time_t mtime = zypp_get_rpmdb_mtime (backend);
+	if (_updates_cache_serial.remember (pool.serial ()) || mtime != _updates_cache_mtime)
+		_updates_cache_valid = FALSE;
+	if (_updates_cache_valid) {
+		_updating_self = _updates_cache_updating_self;
+		return new std::set<zypp::PoolItem> (_updates_cache);
+	}
+
 	std::set<zypp::PoolItem> *candidates = zypp_get_patches (backend);
 
 	if (!_updating_self) {
@@ -799,35 +916,52 @@ zypp_get_updates (PkBackend *backend)
 		std::set<zypp::PoolItem> *packages;
 
 		packages = zypp_get_package_updates (patchRepo);
+
+		// everything the patches contain, by name
+		std::tr1::unordered_map<zypp::sat::detail::IdType, std::vector<zypp::sat::Solvable> > contents;
 		pi_it_t cb = candidates->begin (), ce = candidates->end (), ci;
 		for (ci = cb; ci != ce; ++ci) {
 			if (!zypp::isKind<zypp::Patch>(ci->resolvable()))
 				continue;
 
 			zypp::Patch::constPtr patch = zypp::asKind<zypp::Patch>(ci->resolvable());
-
-			// Remove contained packages from list of packages to add
 			zypp::sat::SolvableSet::const_iterator pki;
-			for (pki = patch->contents().begin(); pki != patch->contents().end(); pki++) {
-
-				pi_it_t pb = packages->begin (), pe = packages->end (), pi;
-				for (pi = pb; pi != pe; ++pi) {
-					if (pi->satSolvable() == zypp::sat::Solvable::noSolvable)
-						continue;
-					
-					if (pi->satSolvable().identical (*pki)) {
-						packages->erase (pi);
+			for (pki = patch->contents().begin(); pki != patch->contents().end(); pki++)
+				contents[pki->ident ().id ()].push_back (*pki);
+		}
+
+		// Remove contained packages from list of packages to add
+		pi_it_t pb = packages->begin (), pe = packages->end (), pi;
+		for (pi = pb; pi != pe; ++pi) {
+			if (pi->satSolvable() == zypp::sat::Solvable::noSolvable) {
+				candidates->insert (*pi);
+				continue;
+			}
+
+			gboolean contained = FALSE;
+			std::tr1::unordered_map<zypp::sat::detail::IdType, std::vector<zypp::sat::Solvable> >::const_iterator found;
+			found = contents.find (pi->satSolvable().ident ().id ());
+			if (found != contents.end ()) {
+				for (std::vector<zypp::sat::Solvable>::const_iterator si = found->second.begin (); si != found->second.end (); ++si) {
+					if (pi->satSolvable().identical (*si)) {
+						contained = TRUE;
 						break;
 					}
 				}
 			}
-		}
 
-		// merge into the list
-		candidates->insert (packages->begin (), packages->end ());
+			// merge into the list
+			if (!contained)
+				candidates->insert (*pi);
+		}
 		delete (packages);
 	}
 
+	_updates_cache = *candidates;
+	_updates_cache_updating_self = _updating_self;
+	_updates_cache_mtime = mtime;
+	_updates_cache_valid = TRUE;
+
 	return candidates;
 }
 
@@ -849,11 +983,86 @@ zypp_check_restart (PkRestartEnum *restart, zypp::Patch::constPtr patch)
 	}
 }
 
+/**
+ * Returns what a solution is cached with, or NULL if it can't be
+ */
+static gchar *
+zypp_get_plan_key (PkBackend *backend, PerformType type, gboolean force)
+{
+	// the same for the simulation and the real transaction
+	gchar *request = pk_backend_get_request_key (backend);
+	if (request == NULL)
+		return NULL;
+
+	std::ostringstream key;
+	key << type << ";" << force << ";" << request;
+	g_free (request);
+	return g_strdup (key.str ().c_str ());
+}
+
+/**
+ * Sets the pool up as the resolver left it for the same simulated
+ * transaction, returns FALSE if there is no such solution
+ */
+static gboolean
+zypp_plan_cache_apply (PkBackend *backend, const gchar *key)
+{
+	gboolean ret = FALSE;
+	zypp::ResPool pool = zypp::ResPool::instance ();
+	time_t mtime = zypp_get_rpmdb_mtime (backend);
+
+	if (key == NULL || g_strcmp0 (key, _plan_cache_key) != 0)
+		goto out;
+
+	// the pool or the rpmdb changed since
+	if (_plan_cache_serial.remember (pool.serial ()) || mtime != _plan_cache_mtime)
+		goto out;
+
+	// The solver does not need to run again: the locks are part of the
+	// pool, which we never change once loaded and which gets a new serial
+	// when reloaded, and setForceResolve and setIgnoreAlreadyRecommended
+	// only depend on the type and force, which are both in the key.
+	// The whole status is put back, as the causer and the reason for each
+	// removal, e.g. isToBeUninstalledDueToUpgrade, tell an update apart
+	// from an erase when notifying and committing.
+	for (std::vector<std::pair<zypp::PoolItem, zypp::ResStatus> >::iterator it = _plan_cache.begin (); it != _plan_cache.end (); ++it)
+		it->first.status () = it->second;
+	g_debug ("reusing the solution of the simulation");
+	ret = TRUE;
+out:
+	// a solution is only ever used once
+	_plan_cache.clear ();
+	g_free (_plan_cache_key);
+	_plan_cache_key = NULL;
+	return ret;
+}
+
+/**
+ * Remembers what the resolver decided for a simulated transaction
+ */
+static void
+zypp_plan_cache_save (PkBackend *backend, const gchar *key)
+{
+	zypp::ResPool pool = zypp::ResPool::instance ();
+
+	_plan_cache.clear ();
+	g_free (_plan_cache_key);
+	_plan_cache_key = g_strdup (key);
+	_plan_cache_serial.remember (pool.serial ());
+	_plan_cache_mtime = zypp_get_rpmdb_mtime (backend);
+
+	for (zypp::ResPool::const_iterator it = pool.begin (); it != pool.end (); it++) {
+		if (it->status ().transacts ())
+			_plan_cache.push_back (std::make_pair (*it, it->status ()));
+	}
+}
+
 gboolean
 zypp_perform_execution (PkBackend *backend, PerformType type, gboolean force)
 {
 	gboolean ret = FALSE;
 	gboolean simulate = pk_backend_get_bool (backend, "hint:simulate");
+	gchar *plan_key = zypp_get_plan_key (backend, type, force);
 
         try {
                 zypp::ZYpp::Ptr zypp = get_zypp (backend);
@@ -865,9 +1074,10 @@ zypp_perform_execution (PkBackend *backend, PerformType type, gboolean force)
 			zypp->resolver ()->setIgnoreAlreadyRecommended (TRUE);
 		}
 
-                // Gather up any dependencies
+                // Gather up any dependencies, unless we just did for the simulation
 		pk_backend_set_status (backend, PK_STATUS_ENUM_DEP_RESOLVE);
-		if (!zypp->resolver ()->resolvePool ()) {
+		gboolean resolved = !simulate && zypp_plan_cache_apply (backend, plan_key);
+		if (!resolved && !zypp->resolver ()->resolvePool ()) {
                        // Manual intervention required to resolve dependencies
                        // TODO: Figure out what we need to do with PackageKit
                        // to pull off interactive problem solving.
@@ -917,6 +1127,10 @@ zypp_perform_execution (PkBackend *backend, PerformType type, gboolean force)
 
 			g_debug ("simulating");
 
+			// the real transaction is usually next
+			if (plan_key != NULL)
+				zypp_plan_cache_save (backend, plan_key);
+
 			for (zypp::ResPool::const_iterator it = pool.begin (); it != pool.end (); it++) {
 				if (!zypp_backend_pool_item_notify (backend, *it, TRUE))
 					ret = FALSE;
@@ -1011,6 +1225,8 @@ zypp_perform_execution (PkBackend *backend, PerformType type, gboolean force)
 	}
 
  exit:
+	g_free (plan_key);
+
 	/* reset the various options */
         try {
                 zypp::ZYpp::Ptr zypp = get_zypp (backend);
@@ -1100,6 +1316,11 @@ zypp_refresh_cache (PkBackend *backend, gboolean force)
 		if (pk_backend_get_is_error_set (backend))
 			break;
 
+		// the repos refreshed so far are complete, so the next
+		// refresh only has to do the rest
+		if (pk_backend_is_cancelled (backend))
+			break;
+
 		// skip disabled repos
 		if (repo.enabled () == false)
 			continue;
@@ -1113,7 +1334,7 @@ zypp_refresh_cache (PkBackend *backend, gboolean force)
 			// Refreshing metadata
 			g_free (_repoName);
 			_repoName = g_strdup (repo.alias ().c_str ());
-			if (zypp_refresh_meta_and_cache (manager, repo, force))
+			if (!zypp_refresh_meta_and_cache (manager, repo, force))
 				break;
 		} catch (const zypp::Exception &ex) {
 			if (repo_messages == NULL) {
@@ -118,12 +118,15 @@ std::vector<zypp::sat::Solvable> * zypp_get_packages_by_name (PkBackend *backend
 							      const zypp::ResKind kind, gboolean include_local = TRUE);
 
 /**
- * Returns a list of packages that owns the specified file.
+ * Returns a list of packages that own any of the specified files, each
+ * package only once. The owners of each file are cached until the rpmdb
+ * changes.
  */
-std::vector<zypp::sat::Solvable> * zypp_get_packages_by_file (PkBackend *backend, const gchar *search_file);
+std::vector<zypp::sat::Solvable> * zypp_get_packages_by_files (PkBackend *backend, gchar **search_files);
 
 /**
  * Returns the Resolvable for the specified package_id.
+ * Lookups are cached until the pool changes.
  */
 zypp::sat::Solvable zypp_get_package_by_id (PkBackend *backend, const gchar *package_id);
 
@@ -162,7 +165,7 @@ zypp::PoolItem zypp_find_arch_update_item (const zypp::ResPool & pool, zypp::Poo
 /**
   * Return the best, most friendly selection of update patches and packages that
   * we can find. Also manages _updating_self to prioritise critical infrastructure
-  * updates.
+  * updates. The result is remembered until the pool or the rpmdb change.
   */
 std::set<zypp::PoolItem> * zypp_get_updates (PkBackend *backend);
 
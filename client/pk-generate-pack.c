@@ -245,6 +245,7 @@ main (int argc, char *argv[])
 	gchar *package_list = NULL;
 	gchar *package = NULL;
 	gboolean updates = FALSE;
+	gboolean compress = FALSE;
 	gint retval = 1;
 
 	const GOptionEntry options[] = {
@@ -260,6 +261,9 @@ main (int argc, char *argv[])
 		{ "updates", 'u', 0, G_OPTION_ARG_NONE, &updates,
 			/* TRANSLATORS: put all pending updates in the pack */
 			_("Put all updates available in the service pack"), NULL},
+		{ "compress", 'z', 0, G_OPTION_ARG_NONE, &compress,
+			/* TRANSLATORS: make the pack smaller, at the cost of time */
+			_("Compress the service pack"), NULL},
 		{ NULL}
 	};
 
@@ -409,6 +413,7 @@ main (int argc, char *argv[])
 		goto out;
 	}
 	pk_service_pack_set_temp_directory (pack, tempdir);
+	pk_service_pack_set_compress (pack, compress);
 
 	/* get the exclude list */
 	excludes = NULL;
@@ -417,7 +417,14 @@ pk_cnf_find_available (const gchar *cmd, guint max_search_time)
 	PkBitfield filters;
 	PkResults *results = NULL;
 	PkError *error_code = NULL;
-	guint cancel_id;
+	guint cancel_id = 0;
+
+	/* use the index the daemon generated when it last refreshed */
+	package_ids = pk_command_index_lookup (PK_COMMAND_INDEX_FILENAME, cmd);
+	if (package_ids != NULL) {
+		g_debug ("found %s in the command index", cmd);
+		goto out;
+	}
 
 	/* create new array of full paths */
 	len = g_strv_length ((gchar **)prefixes);
@@ -1680,6 +1680,57 @@ pk_client_simulate_update_packages (PkClient *client, gchar **package_ids, GCanc
 	return results;
 }
 
+/**
+ * pk_client_batch:
+ * @client: a valid #PkClient instance
+ * @filters: a %PkBitfield such as %PK_FILTER_ENUM_GUI | %PK_FILTER_ENUM_FREE or %PK_FILTER_ENUM_NONE
+ * @roles: a %PkBitfield of %PK_ROLE_ENUM_RESOLVE, %PK_ROLE_ENUM_GET_DETAILS,
+ * %PK_ROLE_ENUM_GET_UPDATE_DETAIL and %PK_ROLE_ENUM_GET_FILES
+ * @packages: package names if @roles contains %PK_ROLE_ENUM_RESOLVE, otherwise package_ids
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: (scope call): the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @error: the #GError to store any failure, or %NULL
+ *
+ * Run several read-only queries on the same packages in one transaction.
+ *
+ * Warning: this function is synchronous, and may block. Do not use it in GUI
+ * applications.
+ *
+ * Return value: (transfer full): a %PkResults object, or NULL for error
+ *
+ * Since: 0.6.11
+ **/
+PkResults *
+pk_client_batch (PkClient *client, PkBitfield filters, PkBitfield roles, gchar **packages, GCancellable *cancellable,
+		 PkProgressCallback progress_callback, gpointer progress_user_data, GError **error)
+{
+	PkClientHelper *helper;
+	PkResults *results;
+
+	g_return_val_if_fail (PK_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* create temp object */
+	helper = g_new0 (PkClientHelper, 1);
+	helper->loop = g_main_loop_new (NULL, FALSE);
+	helper->error = error;
+
+	/* run async method */
+	pk_client_batch_async (client, filters, roles, packages, cancellable, progress_callback, progress_user_data,
+			       (GAsyncReadyCallback) pk_client_generic_finish_sync, helper);
+
+	g_main_loop_run (helper->loop);
+
+	results = helper->results;
+
+	/* free temp object */
+	g_main_loop_unref (helper->loop);
+	g_free (helper);
+
+	return results;
+}
+
 /**
  * pk_client_adopt:
  * @client: a valid #PkClient instance
@@ -281,6 +281,15 @@ PkResults	*pk_client_simulate_update_packages	(PkClient		*client,
 							 gpointer		 progress_user_data,
 							 GError			**error);
 
+PkResults	*pk_client_batch			(PkClient		*client,
+							 PkBitfield		 filters,
+							 PkBitfield		 roles,
+							 gchar			**packages,
+							 GCancellable		*cancellable,
+							 PkProgressCallback	 progress_callback,
+							 gpointer		 progress_user_data,
+							 GError			**error);
+
 PkResults	*pk_client_adopt 			(PkClient		*client,
 							 const gchar		*transaction_id,
 							 GCancellable		*cancellable,
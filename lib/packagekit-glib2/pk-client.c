@@ -68,6 +68,8 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	guint			 cache_age;
+	PkResultsItemCallback	 item_callback;
+	gpointer		 item_user_data;
 };
 
 enum {
@@ -98,6 +100,7 @@ typedef struct {
 	gchar				**package_ids;
 	gchar				*parameter;
 	gchar				*repo_id;
+	gchar				**roles;
 	gchar				**search;
 	gchar				*tid;
 	gchar				*transaction_id;
@@ -668,6 +671,7 @@ pk_client_state_finish (PkClientState *state, const GError *error)
 	g_free (state->transaction_id);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
+	g_strfreev (state->roles);
 	/* results will no exists if the GetTid fails */
 	if (state->results != NULL)
 		g_object_unref (state->results);
@@ -1224,14 +1228,12 @@ pk_client_category_cb (DBusGProxy  *proxy, const gchar *parent_id, const gchar *
 }
 
 /**
- * pk_client_files_cb:
+ * pk_client_file_list_cb:
  */
 static void
-pk_client_files_cb (DBusGProxy *proxy, const gchar *package_id, const gchar *filelist, PkClientState *state)
+pk_client_file_list_cb (DBusGProxy *proxy, const gchar *package_id, gchar **files, PkClientState *state)
 {
-	gchar **files;
 	PkFiles *item;
-	files = g_strsplit (filelist, ";", -1);
 
 	/* add to results */
 	item = pk_files_new ();
@@ -1243,6 +1245,17 @@ pk_client_files_cb (DBusGProxy *proxy, const gchar *package_id, const gchar *fil
 		      NULL);
 	pk_results_add_files (state->results, item);
 	g_object_unref (item);
+}
+
+/**
+ * pk_client_files_cb:
+ */
+static void
+pk_client_files_cb (DBusGProxy *proxy, const gchar *package_id, const gchar *filelist, PkClientState *state)
+{
+	gchar **files;
+	files = g_strsplit (filelist, ";", -1);
+	pk_client_file_list_cb (proxy, package_id, files, state);
 	g_strfreev (files);
 }
 
@@ -1423,6 +1436,7 @@ pk_client_connect_proxy (DBusGProxy *proxy, PkClientState *state)
 				 G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT64,
 				 G_TYPE_INVALID);
 	dbus_g_proxy_add_signal (proxy, "Files", G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INVALID);
+	dbus_g_proxy_add_signal (proxy, "FileList", G_TYPE_STRING, G_TYPE_STRV, G_TYPE_INVALID);
 	dbus_g_proxy_add_signal (proxy, "RepoSignatureRequired",
 				 G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
 				 G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
@@ -1459,6 +1473,8 @@ pk_client_connect_proxy (DBusGProxy *proxy, PkClientState *state)
 				     G_CALLBACK (pk_client_category_cb), state, NULL);
 	dbus_g_proxy_connect_signal (proxy, "Files",
 				     G_CALLBACK (pk_client_files_cb), state, NULL);
+	dbus_g_proxy_connect_signal (proxy, "FileList",
+				     G_CALLBACK (pk_client_file_list_cb), state, NULL);
 	dbus_g_proxy_connect_signal (proxy, "RepoSignatureRequired",
 				     G_CALLBACK (pk_client_repo_signature_required_cb), state, NULL);
 	dbus_g_proxy_connect_signal (proxy, "EulaRequired",
@@ -1506,6 +1522,8 @@ pk_client_disconnect_proxy (DBusGProxy *proxy, PkClientState *state)
 					G_CALLBACK (pk_client_require_restart_cb), state);
 	dbus_g_proxy_disconnect_signal (proxy, "Files",
 					G_CALLBACK (pk_client_files_cb), state);
+	dbus_g_proxy_disconnect_signal (proxy, "FileList",
+					G_CALLBACK (pk_client_file_list_cb), state);
 	dbus_g_proxy_disconnect_signal (proxy, "RepoSignatureRequired",
 					G_CALLBACK (pk_client_repo_signature_required_cb), state);
 	dbus_g_proxy_disconnect_signal (proxy, "EulaRequired",
@@ -1523,6 +1541,28 @@ pk_client_disconnect_proxy (DBusGProxy *proxy, PkClientState *state)
 	state->signals_connected = FALSE;
 }
 
+/**
+ * pk_client_results_set_item_callback:
+ **/
+static void
+pk_client_results_set_item_callback (PkClientState *state)
+{
+	PkClientPrivate *priv = state->client->priv;
+
+	if (priv->item_callback == NULL)
+		return;
+
+	/* PkTask needs the simulated packages to decide what to ask the user */
+	if (state->role == PK_ROLE_ENUM_SIMULATE_INSTALL_FILES ||
+	    state->role == PK_ROLE_ENUM_SIMULATE_INSTALL_PACKAGES ||
+	    state->role == PK_ROLE_ENUM_SIMULATE_REMOVE_PACKAGES ||
+	    state->role == PK_ROLE_ENUM_SIMULATE_UPDATE_PACKAGES) {
+		g_debug ("not streaming %s results", pk_role_enum_to_string (state->role));
+		return;
+	}
+	pk_results_set_item_callback (state->results, priv->item_callback, priv->item_user_data);
+}
+
 /**
  * pk_client_set_role:
  **/
@@ -1568,6 +1608,7 @@ pk_client_set_hints_cb (DBusGProxy *proxy, DBusGProxyCall *call, PkClientState *
 		      "role", state->role,
 		      "progress", state->progress,
 		      NULL);
+	pk_client_results_set_item_callback (state);
 
 	/* setup the proxies ready for use */
 	pk_client_connect_proxy (state->proxy, state);
@@ -1785,6 +1826,15 @@ pk_client_set_hints_cb (DBusGProxy *proxy, DBusGProxyCall *call, PkClientState *
 						       G_TYPE_STRV, state->package_ids,
 						       G_TYPE_INVALID);
 		g_object_set (state->results, "inputs", g_strv_length (state->package_ids), NULL);
+	} else if (state->role == PK_ROLE_ENUM_BATCH) {
+		filters_text = pk_filter_bitfield_to_string (state->filters);
+		state->call = dbus_g_proxy_begin_call (state->proxy, "Batch",
+						       (DBusGProxyCallNotify) pk_client_method_cb, state, NULL,
+						       G_TYPE_STRING, filters_text,
+						       G_TYPE_STRV, state->roles,
+						       G_TYPE_STRV, state->package_ids,
+						       G_TYPE_INVALID);
+		g_object_set (state->results, "inputs", g_strv_length (state->package_ids), NULL);
 	} else {
 		g_assert_not_reached ();
 	}
@@ -1954,6 +2004,10 @@ pk_client_get_tid_cb (GObject *object, GAsyncResult *res, PkClientState *state)
 		g_ptr_array_add (array, hint);
 	}
 
+	/* we can take file lists without them being joined into one string */
+	hint = g_strdup ("supports-file-list=true");
+	g_ptr_array_add (array, hint);
+
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
 	    state->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
@@ -4169,6 +4223,102 @@ out:
 	g_object_unref (res);
 }
 
+/**
+ * pk_client_batch_roles_to_strv:
+ *
+ * The queries are always run in the same order, so the package IDs
+ * from the resolve can be used for the others.
+ **/
+static gchar **
+pk_client_batch_roles_to_strv (PkBitfield roles)
+{
+	guint i;
+	gchar **retval;
+	GPtrArray *array;
+	const PkRoleEnum order[] = { PK_ROLE_ENUM_RESOLVE,
+				     PK_ROLE_ENUM_GET_DETAILS,
+				     PK_ROLE_ENUM_GET_UPDATE_DETAIL,
+				     PK_ROLE_ENUM_GET_FILES,
+				     PK_ROLE_ENUM_UNKNOWN };
+
+	array = g_ptr_array_new ();
+	for (i=0; order[i] != PK_ROLE_ENUM_UNKNOWN; i++) {
+		if (pk_bitfield_contain (roles, order[i]))
+			g_ptr_array_add (array, (gpointer) pk_role_enum_to_string (order[i]));
+	}
+	retval = pk_ptr_array_to_strv (array);
+	g_ptr_array_unref (array);
+	return retval;
+}
+
+/**
+ * pk_client_batch_async:
+ * @client: a valid #PkClient instance
+ * @filters: a %PkBitfield such as %PK_FILTER_ENUM_GUI | %PK_FILTER_ENUM_FREE or %PK_FILTER_ENUM_NONE
+ * @roles: a %PkBitfield of %PK_ROLE_ENUM_RESOLVE, %PK_ROLE_ENUM_GET_DETAILS,
+ * %PK_ROLE_ENUM_GET_UPDATE_DETAIL and %PK_ROLE_ENUM_GET_FILES
+ * @packages: package names if @roles contains %PK_ROLE_ENUM_RESOLVE, otherwise package_ids
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: (scope call): the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @callback_ready: the function to run on completion
+ * @user_data: the data to pass to @callback_ready
+ *
+ * Run several read-only queries on the same packages in one transaction.
+ * If %PK_ROLE_ENUM_RESOLVE is used then it is run first, and the packages
+ * it finds are used for the other queries.
+ * All the results are returned in the one #PkResults.
+ *
+ * Since: 0.6.11
+ **/
+void
+pk_client_batch_async (PkClient *client, PkBitfield filters, PkBitfield roles, gchar **packages, GCancellable *cancellable,
+		       PkProgressCallback progress_callback, gpointer progress_user_data,
+		       GAsyncReadyCallback callback_ready, gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	PkClientState *state;
+	GError *error = NULL;
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+	g_return_if_fail (callback_ready != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	g_return_if_fail (packages != NULL);
+
+	res = g_simple_async_result_new (G_OBJECT (client), callback_ready, user_data, pk_client_batch_async);
+
+	/* save state */
+	state = g_slice_new0 (PkClientState);
+	state->role = PK_ROLE_ENUM_BATCH;
+	state->res = g_object_ref (res);
+	state->client = g_object_ref (client);
+	if (cancellable != NULL) {
+		state->cancellable = g_object_ref (cancellable);
+		state->cancellable_id = g_cancellable_connect (cancellable, G_CALLBACK (pk_client_cancellable_cancel_cb), state, NULL);
+	}
+	state->filters = filters;
+	state->roles = pk_client_batch_roles_to_strv (roles);
+	state->package_ids = g_strdupv (packages);
+	state->progress_callback = progress_callback;
+	state->progress_user_data = progress_user_data;
+	state->progress = pk_progress_new ();
+
+	/* check not already cancelled */
+	if (cancellable != NULL && g_cancellable_set_error_if_cancelled (cancellable, &error)) {
+		pk_client_state_finish (state, error);
+		g_error_free (error);
+		goto out;
+	}
+
+	/* identify */
+	pk_client_set_role (state, state->role);
+
+	/* get tid */
+	pk_control_get_tid_async (client->priv->control, cancellable, (GAsyncReadyCallback) pk_client_get_tid_cb, state);
+out:
+	g_object_unref (res);
+}
+
 /***************************************************************************************************/
 
 /**
@@ -4302,6 +4452,7 @@ pk_client_adopt_async (PkClient *client, const gchar *transaction_id, GCancellab
 		      "role", state->role,
 		      "progress", state->progress,
 		      NULL);
+	pk_client_results_set_item_callback (state);
 
 	/* track state */
 	pk_client_state_add (client, state);
@@ -4674,6 +4825,29 @@ pk_client_get_cache_age (PkClient *client)
 	return client->priv->cache_age;
 }
 
+/**
+ * pk_client_set_item_callback:
+ * @client: a valid #PkClient instance
+ * @callback: the function to call for each result item, or %NULL
+ * @user_data: user data to pass to @callback
+ *
+ * Streams the packages, files, details and other bulk results of the
+ * following transactions to @callback rather than keeping them in the
+ * returned #PkResults. Use this for queries such as GetFiles or GetPackages
+ * that can return very large result sets.
+ *
+ * Simulate transactions are never streamed, as #PkTask needs their results.
+ *
+ * Since: 0.6.11
+ **/
+void
+pk_client_set_item_callback (PkClient *client, PkResultsItemCallback callback, gpointer user_data)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+	client->priv->item_callback = callback;
+	client->priv->item_user_data = user_data;
+}
+
 /**
  * pk_client_class_init:
  **/
@@ -4752,6 +4926,8 @@ pk_client_init (PkClient *client)
 	client->priv->interactive = TRUE;
 	client->priv->idle = TRUE;
 	client->priv->cache_age = 0;
+	client->priv->item_callback = NULL;
+	client->priv->item_user_data = NULL;
 
 	/* check dbus connections, exit if not valid */
 	client->priv->connection = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
@@ -4796,6 +4972,11 @@ pk_client_init (PkClient *client)
 					   G_TYPE_NONE, G_TYPE_STRING,
 					   G_TYPE_STRING, G_TYPE_INVALID);
 
+	/* FileList */
+	dbus_g_object_register_marshaller (pk_marshal_VOID__STRING_BOXED,
+					   G_TYPE_NONE, G_TYPE_STRING,
+					   G_TYPE_STRV, G_TYPE_INVALID);
+
 	/* RepoSignatureRequired */
 	dbus_g_object_register_marshaller (pk_marshal_VOID__STRING_STRING_STRING_STRING_STRING_STRING_STRING_STRING,
 					   G_TYPE_NONE, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
@@ -0,0 +1,250 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/**
+ * The command index maps the commands in the bin directories of the
+ * available packages to the package_ids that ship them, so that
+ * command-not-found can answer without talking to the daemon.
+ *
+ * The file is designed to be used directly with g_mapped_file_new():
+ *
+ *   header:  magic[8], n_entries, strings_offset
+ *   entries: n_entries of {command, package_id}, sorted by command
+ *   strings: NUL terminated strings, referred to by offset
+ *
+ * All the integers are guint32 in host byte order, as the file is
+ * generated on the machine that uses it.
+ **/
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "pk-command-index.h"
+
+#define PK_COMMAND_INDEX_MAGIC		"PKCMD001"
+
+typedef struct {
+	gchar		 magic[8];
+	guint32		 n_entries;
+	guint32		 strings_offset;
+} PkCommandIndexHeader;
+
+typedef struct {
+	guint32		 command;
+	guint32		 package_id;
+} PkCommandIndexEntry;
+
+typedef struct {
+	const gchar	*command;
+	const gchar	*package_id;
+} PkCommandIndexItem;
+
+/**
+ * pk_command_index_add_string:
+ **/
+static guint32
+pk_command_index_add_string (GString *strings, GHashTable *offsets, const gchar *value)
+{
+	gpointer offset;
+
+	if (g_hash_table_lookup_extended (offsets, value, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
+	offset = GUINT_TO_POINTER (strings->len);
+	g_string_append_len (strings, value, strlen (value) + 1);
+	g_hash_table_insert (offsets, (gpointer) value, offset);
+	return GPOINTER_TO_UINT (offset);
+}
+
+/**
+ * pk_command_index_sort_cb:
+ **/
+static gint
+pk_command_index_sort_cb (const PkCommandIndexItem *a, const PkCommandIndexItem *b)
+{
+	gint retval;
+	retval = strcmp (a->command, b->command);
+	if (retval != 0)
+		return retval;
+	return strcmp (a->package_id, b->package_id);
+}
+
+/**
+ * pk_command_index_save:
+ * @commands: a hash of command name to a #GPtrArray of package_ids
+ * @filename: the file to write, usually %PK_COMMAND_INDEX_FILENAME
+ *
+ * Return value: %TRUE if the index was written
+ **/
+gboolean
+pk_command_index_save (GHashTable *commands, const gchar *filename, GError **error)
+{
+	gboolean ret;
+	guint i;
+	GArray *items;
+	GString *data;
+	GString *strings;
+	GHashTable *offsets;
+	GHashTableIter iter;
+	GPtrArray *package_ids;
+	const gchar *command;
+	PkCommandIndexItem item;
+	PkCommandIndexEntry entry;
+	PkCommandIndexHeader header;
+
+	g_return_val_if_fail (commands != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	/* flatten */
+	items = g_array_new (FALSE, FALSE, sizeof (PkCommandIndexItem));
+	g_hash_table_iter_init (&iter, commands);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &command, (gpointer *) &package_ids)) {
+		for (i=0; i<package_ids->len; i++) {
+			item.command = command;
+			item.package_id = g_ptr_array_index (package_ids, i);
+			g_array_append_val (items, item);
+		}
+	}
+	g_array_sort (items, (GCompareFunc) pk_command_index_sort_cb);
+
+	/* build the string table */
+	strings = g_string_new ("");
+	offsets = g_hash_table_new (g_str_hash, g_str_equal);
+	data = g_string_new ("");
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, PK_COMMAND_INDEX_MAGIC, sizeof (header.magic));
+	header.n_entries = items->len;
+	header.strings_offset = sizeof (PkCommandIndexHeader) + items->len * sizeof (PkCommandIndexEntry);
+	g_string_append_len (data, (const gchar *) &header, sizeof (header));
+	for (i=0; i<items->len; i++) {
+		item = g_array_index (items, PkCommandIndexItem, i);
+		entry.command = pk_command_index_add_string (strings, offsets, item.command);
+		entry.package_id = pk_command_index_add_string (strings, offsets, item.package_id);
+		g_string_append_len (data, (const gchar *) &entry, sizeof (entry));
+	}
+	g_string_append_len (data, strings->str, strings->len);
+
+	ret = g_file_set_contents (filename, data->str, data->len, error);
+
+	g_hash_table_unref (offsets);
+	g_string_free (strings, TRUE);
+	g_string_free (data, TRUE);
+	g_array_free (items, TRUE);
+	return ret;
+}
+
+/**
+ * pk_command_index_get_string:
+ **/
+static const gchar *
+pk_command_index_get_string (const gchar *contents, gsize length, const PkCommandIndexHeader *header, guint32 offset)
+{
+	gsize pos;
+	pos = header->strings_offset + offset;
+	if (pos >= length)
+		return NULL;
+	/* the string table must be NUL terminated */
+	if (memchr (contents + pos, '\0', length - pos) == NULL)
+		return NULL;
+	return contents + pos;
+}
+
+/**
+ * pk_command_index_lookup:
+ * @filename: the file to read, usually %PK_COMMAND_INDEX_FILENAME
+ * @command: the command name, e.g. "gnome-power-manager"
+ *
+ * Return value: the package_ids providing the command, or %NULL if the
+ * command or the index was not found
+ **/
+gchar **
+pk_command_index_lookup (const gchar *filename, const gchar *command)
+{
+	GMappedFile *file;
+	GPtrArray *array = NULL;
+	const gchar *contents;
+	const gchar *tmp;
+	const PkCommandIndexHeader *header;
+	const PkCommandIndexEntry *entries;
+	gchar **package_ids = NULL;
+	gsize length;
+	guint low;
+	guint high;
+	guint mid;
+	gint retval;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+	g_return_val_if_fail (command != NULL, NULL);
+
+	file = g_mapped_file_new (filename, FALSE, NULL);
+	if (file == NULL)
+		return NULL;
+
+	/* check it is something we wrote */
+	contents = g_mapped_file_get_contents (file);
+	length = g_mapped_file_get_length (file);
+	if (length < sizeof (PkCommandIndexHeader))
+		goto out;
+	header = (const PkCommandIndexHeader *) contents;
+	if (memcmp (header->magic, PK_COMMAND_INDEX_MAGIC, sizeof (header->magic)) != 0)
+		goto out;
+	if (header->strings_offset != sizeof (PkCommandIndexHeader) + header->n_entries * sizeof (PkCommandIndexEntry) ||
+	    header->strings_offset > length)
+		goto out;
+	entries = (const PkCommandIndexEntry *) (contents + sizeof (PkCommandIndexHeader));
+
+	/* find the first entry for this command */
+	low = 0;
+	high = header->n_entries;
+	while (low < high) {
+		mid = (low + high) / 2;
+		tmp = pk_command_index_get_string (contents, length, header, entries[mid].command);
+		if (tmp == NULL)
+			goto out;
+		retval = strcmp (tmp, command);
+		if (retval < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	/* collect all the packages that provide it */
+	array = g_ptr_array_new ();
+	for (; low < header->n_entries; low++) {
+		tmp = pk_command_index_get_string (contents, length, header, entries[low].command);
+		if (g_strcmp0 (tmp, command) != 0)
+			break;
+		tmp = pk_command_index_get_string (contents, length, header, entries[low].package_id);
+		if (tmp != NULL)
+			g_ptr_array_add (array, g_strdup (tmp));
+	}
+	if (array->len == 0)
+		goto out;
+	g_ptr_array_add (array, NULL);
+	package_ids = (gchar **) g_ptr_array_free (array, FALSE);
+	array = NULL;
+out:
+	if (array != NULL)
+		g_ptr_array_free (array, TRUE);
+	g_mapped_file_unref (file);
+	return package_ids;
+}
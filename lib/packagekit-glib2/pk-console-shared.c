@@ -688,6 +688,10 @@ pk_role_enum_to_localised_present (PkRoleEnum role)
 		/* TRANSLATORS: The role of the transaction, in present tense */
 		text = _("Simulating update");
 		break;
+	case PK_ROLE_ENUM_BATCH:
+		/* TRANSLATORS: The role of the transaction, in present tense */
+		text = _("Getting package information");
+		break;
 	default:
 		g_warning ("role unrecognised: %s", pk_role_enum_to_string (role));
 	}
@@ -38,7 +38,8 @@ static void     pk_desktop_finalize	(GObject        *object);
 #define PK_DESKTOP_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_DESKTOP, PkDesktopPrivate))
 
 /* Database format is:
- *   CREATE TABLE cache ( filename TEXT, package TEXT, show INTEGER, md5 TEXT );
+ *   CREATE TABLE cache ( filename TEXT, package TEXT, show INTEGER, md5 TEXT,
+ *                        inode INTEGER, size INTEGER, mtime INTEGER );
  */
 
 /**
@@ -66,6 +66,8 @@ struct _PkResultsPrivate
 	GPtrArray		*repo_detail_array;
 	GPtrArray		*message_array;
 	PkPackageSack		*package_sack;
+	PkResultsItemCallback	 item_callback;
+	gpointer		 item_user_data;
 };
 
 enum {
@@ -152,6 +154,46 @@ pk_results_set_exit_code (PkResults *results, PkExitEnum exit_enum)
 	return TRUE;
 }
 
+/**
+ * pk_results_set_item_callback:
+ * @results: a valid #PkResults instance
+ * @callback: the function to call for each item, or %NULL
+ * @user_data: user data to pass to @callback
+ *
+ * Puts the results object into streaming mode. Packages, details, update
+ * details, categories, distro upgrades, transactions, files and repo details
+ * are handed to @callback as they arrive and are not kept, so the memory
+ * used does not grow with the size of the result set. Messages, errors,
+ * restarts and the various required-actions are always kept as they are
+ * needed to decide what to do when the transaction finishes.
+ *
+ * Use %NULL to go back to keeping every item.
+ *
+ * Since: 0.6.11
+ **/
+void
+pk_results_set_item_callback (PkResults *results, PkResultsItemCallback callback, gpointer user_data)
+{
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	results->priv->item_callback = callback;
+	results->priv->item_user_data = user_data;
+}
+
+/**
+ * pk_results_stream_item:
+ *
+ * Return value: %TRUE if the item was streamed and should not be kept
+ **/
+static gboolean
+pk_results_stream_item (PkResults *results, gpointer item)
+{
+	if (results->priv->item_callback == NULL)
+		return FALSE;
+	results->priv->item_callback (results, G_OBJECT (item), results->priv->item_user_data);
+	return TRUE;
+}
+
 /**
  * pk_results_add_package:
  * @results: a valid #PkResults instance
@@ -180,6 +222,10 @@ pk_results_add_package (PkResults *results, PkPackage *item)
 		return FALSE;
 	}
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	pk_package_sack_add_package (results->priv->package_sack, item);
 	g_ptr_array_add (results->priv->package_array, g_object_ref (item));
@@ -204,6 +250,10 @@ pk_results_add_details (PkResults *results, PkDetails *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->details_array, g_object_ref (item));
 
@@ -227,6 +277,10 @@ pk_results_add_update_detail (PkResults *results, PkUpdateDetail *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->update_detail_array, g_object_ref (item));
 
@@ -250,6 +304,10 @@ pk_results_add_category (PkResults *results, PkCategory *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->category_array, g_object_ref (item));
 
@@ -273,6 +331,10 @@ pk_results_add_distro_upgrade (PkResults *results, PkDistroUpgrade *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->distro_upgrade_array, g_object_ref (item));
 
@@ -319,6 +381,10 @@ pk_results_add_transaction (PkResults *results, PkTransactionPast *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->transaction_array, g_object_ref (item));
 
@@ -342,6 +408,10 @@ pk_results_add_files (PkResults *results, PkFiles *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->files_array, g_object_ref (item));
 
@@ -434,6 +504,10 @@ pk_results_add_repo_detail (PkResults *results, PkRepoDetail *item)
 	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
 
+	/* the caller is handling the item itself */
+	if (pk_results_stream_item (results, item))
+		return TRUE;
+
 	/* copy and add to array */
 	g_ptr_array_add (results->priv->repo_detail_array, g_object_ref (item));
 
@@ -866,6 +940,8 @@ pk_results_init (PkResults *results)
 	results->priv->inputs = 0;
 	results->priv->progress = NULL;
 	results->priv->error_code = NULL;
+	results->priv->item_callback = NULL;
+	results->priv->item_user_data = NULL;
 	results->priv->package_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->package_sack = pk_package_sack_new ();
 	results->priv->details_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
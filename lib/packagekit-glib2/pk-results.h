@@ -74,6 +74,18 @@ struct _PkResultsClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkResultsItemCallback:
+ * @results: the #PkResults the item was added to
+ * @item: the #PkPackage, #PkFiles or other object that was added
+ * @user_data: user data passed to pk_results_set_item_callback()
+ *
+ * Called for each bulk result item instead of storing it in @results.
+ **/
+typedef void	(*PkResultsItemCallback)		(PkResults		*results,
+							 GObject		*item,
+							 gpointer		 user_data);
+
 GType		 pk_results_get_type		  	(void);
 PkResults	*pk_results_new				(void);
 void		 pk_results_test			(gpointer		 user_data);
@@ -83,6 +95,9 @@ gboolean	 pk_results_set_exit_code		(PkResults		*results,
 							 PkExitEnum		 exit_enum);
 gboolean	 pk_results_set_error_code 		(PkResults		*results,
 							 PkError		*item);
+void		 pk_results_set_item_callback		(PkResults		*results,
+							 PkResultsItemCallback	 callback,
+							 gpointer		 user_data);
 
 /* add */
 gboolean	 pk_results_add_package			(PkResults		*results,
@@ -28,6 +28,7 @@
 #include "pk-catalog.h"
 #include "pk-client.h"
 #include "pk-client-helper.h"
+#include "pk-command-index.h"
 #include "pk-common.h"
 #include "pk-control.h"
 #include "pk-console-shared.h"
@@ -470,6 +471,36 @@ pk_test_client_get_details_cb (GObject *object, GAsyncResult *res, gpointer user
 	_g_test_loop_quit ();
 }
 
+static void
+pk_test_client_batch_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	PkClient *client = PK_CLIENT (object);
+	GError *error = NULL;
+	PkResults *results = NULL;
+	PkExitEnum exit_enum;
+	GPtrArray *packages;
+	GPtrArray *details;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+	g_assert_no_error (error);
+	g_assert (results != NULL);
+
+	exit_enum = pk_results_get_exit_code (results);
+	g_assert_cmpint (exit_enum, ==, PK_EXIT_ENUM_SUCCESS);
+
+	/* the resolve and the get-details both ended up in the same results */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 1);
+	details = pk_results_get_details_array (results);
+	g_assert_cmpint (details->len, ==, 1);
+
+	g_ptr_array_unref (packages);
+	g_ptr_array_unref (details);
+	g_object_unref (results);
+	_g_test_loop_quit ();
+}
+
 static void
 pk_test_client_get_updates_cb (GObject *object, GAsyncResult *res, gpointer user_data)
 {
@@ -765,6 +796,16 @@ pk_test_client_func (void)
 	_g_test_loop_run_with_timeout (15000);
 	g_debug ("resolved in %f", g_test_timer_elapsed ());
 
+	/* resolve and get details in one transaction */
+	values = g_strsplit ("powertop", "&", -1);
+	pk_client_batch_async (client, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED),
+			       pk_bitfield_from_enums (PK_ROLE_ENUM_RESOLVE, PK_ROLE_ENUM_GET_DETAILS, -1),
+			       values, NULL, NULL, NULL,
+			       (GAsyncReadyCallback) pk_test_client_batch_cb, NULL);
+	g_strfreev (values);
+	_g_test_loop_run_with_timeout (15000);
+	g_debug ("got batch in %f", g_test_timer_elapsed ());
+
 	/* got updates */
 	g_assert_cmpint (_progress_cb, >, 0);
 	g_assert_cmpint (_status_cb, >, 0);
@@ -837,6 +878,60 @@ pk_test_client_func (void)
 	g_object_unref (client);
 }
 
+static void
+pk_test_command_index_func (void)
+{
+	gboolean ret;
+	gchar *filename;
+	gchar **package_ids;
+	GHashTable *commands;
+	GPtrArray *array;
+	GError *error = NULL;
+
+	filename = g_build_filename (g_get_tmp_dir (), "pk-self-test.index", NULL);
+	commands = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+
+	array = g_ptr_array_new ();
+	g_ptr_array_add (array, "powertop;1.8-1.fc8;i386;fedora");
+	g_hash_table_insert (commands, "powertop", array);
+	array = g_ptr_array_new ();
+	g_ptr_array_add (array, "vim-enhanced;7.2;i386;fedora");
+	g_ptr_array_add (array, "vim-X11;7.2;i386;fedora");
+	g_hash_table_insert (commands, "vim", array);
+
+	/* save the index */
+	ret = pk_command_index_save (commands, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* find a single package */
+	package_ids = pk_command_index_lookup (filename, "powertop");
+	g_assert (package_ids != NULL);
+	g_assert_cmpint (g_strv_length (package_ids), ==, 1);
+	g_assert_cmpstr (package_ids[0], ==, "powertop;1.8-1.fc8;i386;fedora");
+	g_strfreev (package_ids);
+
+	/* find multiple packages */
+	package_ids = pk_command_index_lookup (filename, "vim");
+	g_assert (package_ids != NULL);
+	g_assert_cmpint (g_strv_length (package_ids), ==, 2);
+	g_strfreev (package_ids);
+
+	/* find nothing */
+	package_ids = pk_command_index_lookup (filename, "vi");
+	g_assert (package_ids == NULL);
+	package_ids = pk_command_index_lookup (filename, "zzz");
+	g_assert (package_ids == NULL);
+
+	/* no index */
+	package_ids = pk_command_index_lookup ("/does-not-exist", "vim");
+	g_assert (package_ids == NULL);
+
+	g_unlink (filename);
+	g_hash_table_unref (commands);
+	g_free (filename);
+}
+
 static void
 pk_test_common_func (void)
 {
@@ -954,7 +1049,7 @@ pk_test_control_get_properties_cb (GObject *object, GAsyncResult *res, gpointer
 		     "refresh-cache;remove-packages;repo-enable;repo-set-data;resolve;rollback;"
 		     "search-details;search-file;search-group;search-name;update-packages;update-system;"
 		     "what-provides;download-packages;get-distro-upgrades;simulate-install-packages;"
-		     "simulate-remove-packages;simulate-update-packages");
+		     "simulate-remove-packages;simulate-update-packages;batch");
 	g_free (text);
 
 	/* check filters */
@@ -1098,7 +1193,7 @@ pk_test_control_func (void)
 		     "refresh-cache;remove-packages;repo-enable;repo-set-data;resolve;rollback;"
 		     "search-details;search-file;search-group;search-name;update-packages;update-system;"
 		     "what-provides;download-packages;get-distro-upgrades;simulate-install-packages;"
-		     "simulate-remove-packages;simulate-update-packages");
+		     "simulate-remove-packages;simulate-update-packages;batch");
 	g_free (text);
 
 	g_object_unref (control);
@@ -1596,10 +1691,19 @@ pk_test_progress_bar (void)
 	g_object_unref (progress_bar);
 }
 
+static void
+pk_test_results_item_cb (PkResults *results, GObject *item, gpointer user_data)
+{
+	guint *streamed = (guint *) user_data;
+	g_assert (PK_IS_PACKAGE (item));
+	(*streamed)++;
+}
+
 static void
 pk_test_results_func (void)
 {
 	gboolean ret;
+	guint streamed = 0;
 	PkResults *results;
 	PkExitEnum exit_enum;
 	GPtrArray *packages;
@@ -1672,6 +1776,24 @@ pk_test_results_func (void)
 	g_free (package_id);
 	g_free (summary);
 
+	/* stream the next package rather than keeping it */
+	pk_results_set_item_callback (results, pk_test_results_item_cb, &streamed);
+	item = pk_package_new ();
+	g_object_set (item,
+		      "info", PK_INFO_ENUM_AVAILABLE,
+		      "package-id", "powertop;1.8-1.fc8;i386;fedora",
+		      "summary", "Power consumption monitor",
+		      NULL);
+	ret = pk_results_add_package (results, item);
+	g_object_unref (item);
+	g_assert (ret);
+	g_assert_cmpint (streamed, ==, 1);
+
+	/* check it was not added */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 1);
+	g_ptr_array_unref (packages);
+
 	g_object_unref (results);
 }
 
@@ -2059,6 +2181,7 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	g_test_add_func ("/packagekit-glib2/common", pk_test_common_func);
+	g_test_add_func ("/packagekit-glib2/command-index", pk_test_command_index_func);
 	g_test_add_func ("/packagekit-glib2/enum", pk_test_enum_func);
 	g_test_add_func ("/packagekit-glib2/desktop", pk_test_desktop_func);
 	g_test_add_func ("/packagekit-glib2/bitfield", pk_test_bitfield_func);
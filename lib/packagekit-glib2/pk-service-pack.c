@@ -51,6 +51,15 @@
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
 
+/* how many packages to download in each request, and how many requests to
+ * keep running so that writing the archive overlaps with downloading */
+#define PK_SERVICE_PACK_DOWNLOAD_CHUNK		10
+#define PK_SERVICE_PACK_DOWNLOADS_IN_FLIGHT	2
+
+/* large enough that writing is limited by the disk, not by syscalls */
+#define PK_SERVICE_PACK_BLOCK_SIZE		(64 * 1024)
+#define PK_SERVICE_PACK_WRITE_SIZE		(1024 * 1024)
+
 #define PK_SERVICE_PACK_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SERVICE_PACK, PkServicePackPrivate))
 
 typedef enum {
@@ -76,6 +85,13 @@ typedef struct {
 	PkProgressCallback		 progress_callback;
 	PkServicePack			*pack;
 	PkServicePackType		 type;
+	gchar				**package_ids_to_download;
+	guint				 download_index;
+	guint				 in_flight;
+	GError				*error;
+#ifdef HAVE_ARCHIVE_H
+	struct archive			*arch;
+#endif
 } PkServicePackState;
 
 /**
@@ -86,6 +102,7 @@ typedef struct {
 struct _PkServicePackPrivate
 {
 	gchar			*directory;
+	gboolean		 compress;
 	PkClient		*client;
 };
 
@@ -222,8 +239,9 @@ pk_service_pack_extract (const gchar *filename, const gchar *directory, GError *
 		goto out;
 	}
 
-	/* we can only read tar achives */
+	/* we can only read tar achives, but they may be compressed */
 	arch = archive_read_new ();
+	archive_read_support_compression_all (arch);
 	archive_read_support_format_tar (arch);
 
 	/* open the tar file */
@@ -435,6 +453,26 @@ pk_service_pack_set_temp_directory (PkServicePack *pack, const gchar *directory)
 	return TRUE;
 }
 
+/**
+ * pk_service_pack_set_compress:
+ * @pack: a valid #PkServicePack instance
+ * @compress: if the service pack should be compressed
+ *
+ * Sets whether new service packs are gzip compressed. This makes the packs
+ * smaller at the cost of CPU time; packages are often already compressed.
+ *
+ * Return value: %TRUE if set correctly
+ *
+ * Since: 0.6.11
+ **/
+gboolean
+pk_service_pack_set_compress (PkServicePack *pack, gboolean compress)
+{
+	g_return_val_if_fail (PK_IS_SERVICE_PACK (pack), FALSE);
+	pack->priv->compress = compress;
+	return TRUE;
+}
+
 #ifdef HAVE_ARCHIVE_H
 /**
  * pk_service_pack_create_metadata_file:
@@ -495,19 +533,25 @@ out:
 
 /**
  * pk_service_pack_archive_add_file:
+ *
+ * The file is mapped rather than read into a bounce buffer, and handed to
+ * libarchive in large slices.
  **/
 static gboolean
 pk_service_pack_archive_add_file (struct archive *arch, const gchar *filename, GError **error)
 {
 	int retval;
-	int len;
-	int fd = -1;
-	int wrote;
 	gboolean ret = FALSE;
 	gchar *filename_basename = NULL;
 	struct archive_entry *entry = NULL;
 	struct stat st;
-	gchar buff[8192];
+	GMappedFile *file = NULL;
+	GError *error_local = NULL;
+	const gchar *data;
+	gsize length;
+	gsize offset = 0;
+	gsize chunk;
+	ssize_t wrote;
 
 	/* stat file */
 	retval = stat (filename, &st);
@@ -518,6 +562,17 @@ pk_service_pack_archive_add_file (struct archive *arch, const gchar *filename, G
 	}
 	g_debug ("stat(%s), size=%lu bytes\n", filename, (glong) st.st_size);
 
+	/* map file to copy */
+	file = g_mapped_file_new (filename, FALSE, &error_local);
+	if (file == NULL) {
+		g_set_error (error, PK_SERVICE_PACK_ERROR, PK_SERVICE_PACK_ERROR_FAILED_CREATE,
+				      "failed to map %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+	data = g_mapped_file_get_contents (file);
+	length = g_mapped_file_get_length (file);
+
 	/* create new entry */
 	entry = archive_entry_new ();
 	archive_entry_copy_stat (entry, &st);
@@ -526,7 +581,7 @@ pk_service_pack_archive_add_file (struct archive *arch, const gchar *filename, G
 
 	/* ._BIG FAT BUG_. We should not have to do this, as it should be
 	 * set from archive_entry_copy_stat() */
-	archive_entry_set_size (entry, st.st_size);
+	archive_entry_set_size (entry, length);
 
 	/* write header */
 	retval = archive_write_header (arch, entry);
@@ -536,28 +591,21 @@ pk_service_pack_archive_add_file (struct archive *arch, const gchar *filename, G
 		goto out;
 	}
 
-	/* open file to copy */
-	fd = open (filename, O_RDONLY);
-	if (fd < 0) {
-		g_set_error (error, PK_SERVICE_PACK_ERROR, PK_SERVICE_PACK_ERROR_FAILED_CREATE,
-				      "failed to get fd for %s", filename);
-		goto out;
-	}
-
-	/* ITS4: ignore, buffer statically preallocated  */
-	len = read (fd, buff, sizeof (buff));
-	/* write data to archive -- how come no convenience function? */
-	while (len > 0) {
-		wrote = archive_write_data (arch, buff, len);
-		if (wrote != len)
-			g_warning("wrote %i instead of %i\n", wrote, len);
-		/* ITS4: ignore, buffer statically preallocated  */
-		len = read (fd, buff, sizeof (buff));
+	/* write data to archive */
+	while (offset < length) {
+		chunk = MIN (length - offset, PK_SERVICE_PACK_WRITE_SIZE);
+		wrote = archive_write_data (arch, data + offset, chunk);
+		if (wrote <= 0) {
+			g_set_error (error, PK_SERVICE_PACK_ERROR, PK_SERVICE_PACK_ERROR_FAILED_CREATE,
+					      "failed to write %s: %s", filename, archive_error_string (arch));
+			goto out;
+		}
+		offset += wrote;
 	}
 	ret = TRUE;
 out:
-	if (fd >= 0)
-		close (fd);
+	if (file != NULL)
+		g_mapped_file_unref (file);
 	if (entry != NULL)
 		archive_entry_free (entry);
 	g_free (filename_basename);
@@ -565,19 +613,17 @@ out:
 }
 
 /**
- * pk_service_pack_create_from_files:
+ * pk_service_pack_archive_open:
+ *
+ * Opens the archive and adds the metadata, so the packages can be appended
+ * as soon as they have been downloaded.
  **/
 static gboolean
-pk_service_pack_create_from_files (PkServicePackState *state, gchar **file_array, GError **error)
+pk_service_pack_archive_open (PkServicePackState *state, GError **error)
 {
-	struct archive *arch = NULL;
 	gboolean ret = FALSE;
-	guint i;
 	gchar *filename;
-	gchar **files_and_metadata = NULL;
-
-	g_return_val_if_fail (file_array != NULL, FALSE);
-	g_return_val_if_fail (error != NULL, FALSE);
+	gint retval;
 
 	/* create a file with metadata in it */
 	filename = g_build_filename (g_get_tmp_dir (), "metadata.conf", NULL);
@@ -587,49 +633,96 @@ pk_service_pack_create_from_files (PkServicePackState *state, gchar **file_array
 				      "failed to generate metadata file %s", filename);
 		goto out;
 	}
-	files_and_metadata = pk_package_ids_add_id (file_array, filename);
 
-	/* we can only write tar achives */
-	arch = archive_write_new ();
-	archive_write_set_compression_none (arch);
-	archive_write_set_format_ustar (arch);
-	archive_write_open_filename (arch, state->filename);
+	/* tar, optionally compressed */
+	state->arch = archive_write_new ();
+	if (state->pack->priv->compress)
+		archive_write_set_compression_gzip (state->arch);
+	else
+		archive_write_set_compression_none (state->arch);
+	archive_write_set_format_ustar (state->arch);
+	archive_write_set_bytes_per_block (state->arch, PK_SERVICE_PACK_BLOCK_SIZE);
+	retval = archive_write_open_filename (state->arch, state->filename);
+	if (retval != ARCHIVE_OK) {
+		g_set_error (error, PK_SERVICE_PACK_ERROR, PK_SERVICE_PACK_ERROR_FAILED_CREATE,
+				      "failed to open %s: %s", state->filename, archive_error_string (state->arch));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* the metadata goes first */
+	ret = pk_service_pack_archive_add_file (state->arch, filename, error);
+out:
+	g_remove (filename);
+	g_free (filename);
+	return ret;
+}
+
+/**
+ * pk_service_pack_archive_add_files:
+ **/
+static gboolean
+pk_service_pack_archive_add_files (PkServicePackState *state, gchar **file_array, GError **error)
+{
+	gboolean ret = TRUE;
+	guint i;
 
 	/* for each filename */
-	for (i=0; files_and_metadata[i] != NULL; i++) {
+	for (i=0; file_array[i] != NULL; i++) {
 		/* try to add to archive */
-		ret = pk_service_pack_archive_add_file (arch, files_and_metadata[i], error);
+		ret = pk_service_pack_archive_add_file (state->arch, file_array[i], error);
 		if (!ret)
-			goto out;
+			break;
 	}
 
-	/* completed all okay */
-	ret = TRUE;
-out:
-	g_strfreev (files_and_metadata);
-	g_free (filename);
 	/* delete each filename */
 	for (i=0; file_array[i] != NULL; i++)
 		g_remove (file_array[i]);
-
-	/* close the archive */
-	if (arch != NULL) {
-		archive_write_close (arch);
-		archive_write_finish (arch);
-	}
 	return ret;
 }
+
+/**
+ * pk_service_pack_archive_close:
+ **/
+static void
+pk_service_pack_archive_close (PkServicePackState *state)
+{
+	if (state->arch == NULL)
+		return;
+	archive_write_close (state->arch);
+	archive_write_finish (state->arch);
+	state->arch = NULL;
+}
 #else
 /**
- * pk_service_pack_create_from_files:
+ * pk_service_pack_archive_open:
  **/
 static gboolean
-pk_service_pack_create_from_files (PkServicePackState *state, gchar **file_array, GError **error)
+pk_service_pack_archive_open (PkServicePackState *state, GError **error)
 {
 	g_set_error_literal (error, PK_SERVICE_PACK_ERROR, PK_SERVICE_PACK_ERROR_FAILED_CREATE,
 			      "The service pack cannot be created as PackageKit was not built with libarchive support");
 	return FALSE;
 }
+
+/**
+ * pk_service_pack_archive_add_files:
+ **/
+static gboolean
+pk_service_pack_archive_add_files (PkServicePackState *state, gchar **file_array, GError **error)
+{
+	g_set_error_literal (error, PK_SERVICE_PACK_ERROR, PK_SERVICE_PACK_ERROR_FAILED_CREATE,
+			     "The service pack cannot be created as PackageKit was not built with libarchive support");
+	return FALSE;
+}
+
+/**
+ * pk_service_pack_archive_close:
+ **/
+static void
+pk_service_pack_archive_close (PkServicePackState *state)
+{
+}
 #endif
 
 /**
@@ -653,6 +746,7 @@ pk_service_pack_generic_state_finish (PkServicePackState *state, const GError *e
 		g_object_unref (state->cancellable);
 	g_strfreev (state->package_ids);
 	g_strfreev (state->package_ids_exclude);
+	g_strfreev (state->package_ids_to_download);
 	g_free (state->filename);
 	g_object_unref (state->res);
 	g_object_unref (state->pack);
@@ -691,6 +785,71 @@ out:
 	return files;
 }
 
+/**
+ * pk_service_pack_remove_files:
+ **/
+static void
+pk_service_pack_remove_files (gchar **files)
+{
+	guint i;
+	if (files == NULL)
+		return;
+	for (i=0; files[i] != NULL; i++)
+		g_remove (files[i]);
+}
+
+static void pk_service_pack_download_ready_cb (GObject *source_object, GAsyncResult *res, PkServicePackState *state);
+
+/**
+ * pk_service_pack_download_next:
+ *
+ * Keeps a few DownloadPackages requests in flight, so that the packages
+ * from one chunk are written into the archive while the next chunk is
+ * still downloading.
+ **/
+static void
+pk_service_pack_download_next (PkServicePackState *state)
+{
+	guint i;
+	gchar **package_ids;
+	GError *error;
+
+	while (state->error == NULL &&
+	       state->in_flight < PK_SERVICE_PACK_DOWNLOADS_IN_FLIGHT &&
+	       state->package_ids_to_download[state->download_index] != NULL) {
+
+		/* the client copies the array, so we don't need to copy the strings */
+		package_ids = g_new0 (gchar *, PK_SERVICE_PACK_DOWNLOAD_CHUNK + 1);
+		for (i=0; i<PK_SERVICE_PACK_DOWNLOAD_CHUNK; i++) {
+			if (state->package_ids_to_download[state->download_index] == NULL)
+				break;
+			package_ids[i] = state->package_ids_to_download[state->download_index++];
+		}
+
+		state->in_flight++;
+		pk_client_download_packages_async (state->pack->priv->client, package_ids, state->pack->priv->directory,
+						   state->cancellable, state->progress_callback, state->progress_user_data,
+						   (GAsyncReadyCallback) pk_service_pack_download_ready_cb, state);
+		g_free (package_ids);
+	}
+
+	/* wait for the others */
+	if (state->in_flight > 0)
+		return;
+
+	/* everything has been written, or we failed */
+	pk_service_pack_archive_close (state);
+	state->ret = (state->error == NULL);
+	if (!state->ret)
+		g_remove (state->filename);
+
+	/* we're done */
+	error = state->error;
+	pk_service_pack_generic_state_finish (state, error);
+	if (error != NULL)
+		g_error_free (error);
+}
+
 /**
  * pk_service_pack_download_ready_cb:
  **/
@@ -700,46 +859,42 @@ pk_service_pack_download_ready_cb (GObject *source_object, GAsyncResult *res, Pk
 	PkClient *client = PK_CLIENT (source_object);
 	GError *error = NULL;
 	PkResults *results;
-	gboolean ret;
 	gchar **files = NULL;
 	GPtrArray *array = NULL;
 	PkError *error_code = NULL;
 
+	state->in_flight--;
+
 	/* get the results */
 	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		pk_service_pack_generic_state_finish (state, error);
-		g_error_free (error);
+	if (results == NULL)
 		goto out;
-	}
 
 	/* check error code */
 	error_code = pk_results_get_error_code (results);
 	if (error_code != NULL) {
 		error = g_error_new (1, 0, "failed to download: %s", pk_error_get_details (error_code));
-		pk_service_pack_generic_state_finish (state, error);
-		g_error_free (error);
 		goto out;
 	}
 
-	/* get the files data */
+	/* another chunk failed, so just clean up */
 	array = pk_results_get_files_array (results);
-
-	/* now create pack */
 	files = pk_service_pack_get_files_from_array (array);
-	ret = pk_service_pack_create_from_files (state, files, &error);
-	if (!ret) {
-		pk_service_pack_generic_state_finish (state, error);
-		g_error_free (error);
+	if (state->error != NULL) {
+		pk_service_pack_remove_files (files);
 		goto out;
 	}
 
-	/* we can't handle this, just finish the async method */
-	state->ret = TRUE;
-
-	/* we're done */
-	pk_service_pack_generic_state_finish (state, error);
+	/* append to the pack straight away */
+	pk_service_pack_archive_add_files (state, files, &error);
 out:
+	/* only keep the first error */
+	if (error != NULL) {
+		if (state->error == NULL)
+			state->error = error;
+		else
+			g_error_free (error);
+	}
 	g_strfreev (files);
 	if (error_code != NULL)
 		g_object_unref (error_code);
@@ -747,7 +902,35 @@ out:
 		g_ptr_array_unref (array);
 	if (results != NULL)
 		g_object_unref (results);
-	return;
+
+	/* start the next chunk, or finish */
+	pk_service_pack_download_next (state);
+}
+
+/**
+ * pk_service_pack_remove_duplicates:
+ *
+ * Return value: the package IDs in the same order, with each only once, so
+ * the pack does not get the same member twice
+ **/
+static gchar **
+pk_service_pack_remove_duplicates (gchar **package_ids)
+{
+	guint i;
+	guint j = 0;
+	gchar **unique;
+	GHashTable *hash;
+
+	unique = g_new0 (gchar *, g_strv_length (package_ids) + 1);
+	hash = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i=0; package_ids[i] != NULL; i++) {
+		if (g_hash_table_lookup (hash, package_ids[i]) != NULL)
+			continue;
+		g_hash_table_insert (hash, package_ids[i], package_ids[i]);
+		unique[j++] = g_strdup (package_ids[i]);
+	}
+	g_hash_table_destroy (hash);
+	return unique;
 }
 
 /**
@@ -780,8 +963,9 @@ pk_service_pack_get_depends_ready_cb (GObject *source_object, GAsyncResult *res,
 	guint i;
 	guint j = 0;
 	PkPackage *package;
+	gboolean ret;
 	gchar **package_ids = NULL;
-	gchar **package_ids_to_download = NULL;
+	gchar **package_ids_all;
 	PkError *error_code = NULL;
 
 	/* get the results */
@@ -810,15 +994,23 @@ pk_service_pack_get_depends_ready_cb (GObject *source_object, GAsyncResult *res,
 		if (!pk_service_pack_in_excludes_list (state, pk_package_get_id (package)))
 			package_ids[j++] = g_strdup (pk_package_get_id (package));
 	}
-	package_ids_to_download = pk_package_ids_add_ids (state->package_ids, package_ids);
+	package_ids_all = pk_package_ids_add_ids (state->package_ids, package_ids);
+	state->package_ids_to_download = pk_service_pack_remove_duplicates (package_ids_all);
+	g_strfreev (package_ids_all);
+
+	/* open the pack now, so each package can be added as it arrives */
+	ret = pk_service_pack_archive_open (state, &error);
+	if (!ret) {
+		pk_service_pack_archive_close (state);
+		pk_service_pack_generic_state_finish (state, error);
+		g_error_free (error);
+		goto out;
+	}
 
 	/* now download */
-	pk_client_download_packages_async (state->pack->priv->client, package_ids_to_download, state->pack->priv->directory,
-					   state->cancellable, state->progress_callback, state->progress_user_data,
-					   (GAsyncReadyCallback) pk_service_pack_download_ready_cb, state);
+	pk_service_pack_download_next (state);
 out:
 	g_strfreev (package_ids);
-	g_strfreev (package_ids_to_download);
 	if (error_code != NULL)
 		g_object_unref (error_code);
 	if (array != NULL)
@@ -1053,6 +1245,7 @@ pk_service_pack_init (PkServicePack *pack)
 	pack->priv = PK_SERVICE_PACK_GET_PRIVATE (pack);
 	pack->priv->client = pk_client_new ();
 	pack->priv->directory = NULL;
+	pack->priv->compress = FALSE;
 }
 
 /**
@@ -90,6 +90,8 @@ gboolean	 pk_service_pack_check_valid		(PkServicePack		*pack,
 /* used by clients */
 gboolean	 pk_service_pack_set_temp_directory	(PkServicePack		*pack,
 							 const gchar		*directory);
+gboolean	 pk_service_pack_set_compress		(PkServicePack		*pack,
+							 gboolean		 compress);
 
 gboolean	 pk_service_pack_generic_finish		(PkServicePack		*pack,
 							 GAsyncResult		*res,
@@ -1150,3 +1150,54 @@ pk_task_repo_enable_sync (PkTask *task, const gchar *repo_id, gboolean enabled,
 	return results;
 }
 
+/**
+ * pk_task_batch_sync:
+ * @task: a valid #PkTask instance
+ * @filters: a bitfield of filters that can be used to limit the results
+ * @roles: a %PkBitfield of %PK_ROLE_ENUM_RESOLVE, %PK_ROLE_ENUM_GET_DETAILS,
+ * %PK_ROLE_ENUM_GET_UPDATE_DETAIL and %PK_ROLE_ENUM_GET_FILES
+ * @packages: package names if @roles contains %PK_ROLE_ENUM_RESOLVE, otherwise package_ids
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @error: the #GError to store any failure, or %NULL
+ *
+ * Run several read-only queries on the same packages in one transaction.
+ *
+ * Warning: this function is synchronous, and may block. Do not use it in GUI
+ * applications.
+ *
+ * Return value: a %PkResults object, or NULL for error
+ *
+ * Since: 0.6.11
+ **/
+PkResults *
+pk_task_batch_sync (PkTask *task, PkBitfield filters, PkBitfield roles, gchar **packages, GCancellable *cancellable,
+		    PkProgressCallback progress_callback, gpointer progress_user_data,
+		    GError **error)
+{
+	PkTaskHelper *helper;
+	PkResults *results;
+
+	g_return_val_if_fail (PK_IS_TASK (task), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* create temp object */
+	helper = g_new0 (PkTaskHelper, 1);
+	helper->loop = g_main_loop_new (NULL, FALSE);
+	helper->error = error;
+
+	/* run async method */
+	pk_task_batch_async (task, filters, roles, packages, cancellable, progress_callback, progress_user_data,
+			     (GAsyncReadyCallback) pk_task_generic_finish_sync, helper);
+
+	g_main_loop_run (helper->loop);
+
+	results = helper->results;
+
+	/* free temp object */
+	g_main_loop_unref (helper->loop);
+	g_free (helper);
+
+	return results;
+}
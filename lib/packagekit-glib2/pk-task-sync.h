@@ -210,6 +210,15 @@ PkResults	*pk_task_repo_enable_sync		(PkTask			*task,
 							 gpointer		 progress_user_data,
 							 GError			**error);
 
+PkResults	*pk_task_batch_sync			(PkTask			*task,
+							 PkBitfield		 filters,
+							 PkBitfield		 roles,
+							 gchar			**packages,
+							 GCancellable		*cancellable,
+							 PkProgressCallback	 progress_callback,
+							 gpointer		 progress_user_data,
+							 GError			**error);
+
 G_END_DECLS
 
 #endif /* __PK_TASK_SYNC_H */
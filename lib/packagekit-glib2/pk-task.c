@@ -88,6 +88,7 @@ typedef struct {
 	gchar				*transaction_id;
 	gchar				**values;
 	PkBitfield			 filters;
+	PkBitfield			 roles;
 	PkProvidesEnum			 provides;
 } PkTaskState;
 
@@ -272,6 +273,10 @@ pk_task_do_async_action (PkTaskState *state)
 		pk_client_repo_enable_async (PK_CLIENT(state->task), state->repo_id, state->enabled,
 					     state->cancellable, state->progress_callback, state->progress_user_data,
 					     (GAsyncReadyCallback) pk_task_ready_cb, state);
+	} else if (state->role == PK_ROLE_ENUM_BATCH) {
+		pk_client_batch_async (PK_CLIENT(state->task), state->filters, state->roles, state->packages,
+				       state->cancellable, state->progress_callback, state->progress_user_data,
+				       (GAsyncReadyCallback) pk_task_ready_cb, state);
 	} else {
 		g_assert_not_reached ();
 	}
@@ -2180,6 +2185,62 @@ pk_task_repo_enable_async (PkTask *task, const gchar *repo_id, gboolean enabled,
 	g_object_unref (res);
 }
 
+/**
+ * pk_task_batch_async:
+ * @task: a valid #PkTask instance
+ * @filters: a bitfield of filters that can be used to limit the results
+ * @roles: a %PkBitfield of %PK_ROLE_ENUM_RESOLVE, %PK_ROLE_ENUM_GET_DETAILS,
+ * %PK_ROLE_ENUM_GET_UPDATE_DETAIL and %PK_ROLE_ENUM_GET_FILES
+ * @packages: package names if @roles contains %PK_ROLE_ENUM_RESOLVE, otherwise package_ids
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @callback_ready: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Run several read-only queries on the same packages in one transaction.
+ *
+ * Since: 0.6.11
+ **/
+void
+pk_task_batch_async (PkTask *task, PkBitfield filters, PkBitfield roles, gchar **packages, GCancellable *cancellable,
+		     PkProgressCallback progress_callback, gpointer progress_user_data,
+		     GAsyncReadyCallback callback_ready, gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	PkTaskState *state;
+
+	g_return_if_fail (PK_IS_TASK (task));
+	g_return_if_fail (callback_ready != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	res = g_simple_async_result_new (G_OBJECT (task), callback_ready, user_data, pk_task_install_packages_async);
+
+	/* save state */
+	state = g_slice_new0 (PkTaskState);
+	state->role = PK_ROLE_ENUM_BATCH;
+	state->res = g_object_ref (res);
+	state->task = g_object_ref (task);
+	if (cancellable != NULL)
+		state->cancellable = g_object_ref (cancellable);
+	state->progress_callback = progress_callback;
+	state->progress_user_data = progress_user_data;
+	state->ret = FALSE;
+	state->only_trusted = TRUE;
+	state->filters = filters;
+	state->roles = roles;
+	state->packages = g_strdupv (packages);
+	state->request = pk_task_generate_request_id ();
+
+	g_debug ("adding state %p", state);
+	g_ptr_array_add (task->priv->array, state);
+
+	/* run task with callbacks */
+	pk_task_do_async_action (state);
+
+	g_object_unref (res);
+}
+
 /**
  * pk_task_generic_finish:
  * @task: a valid #PkTask instance
@@ -87,7 +87,8 @@ Transaction::Transaction(const QString &tid, QObject *parent)
     } else {
         d->error = Client::NoError;
         Client::instance()->d_ptr->runningTransactions.insert(d->tid, this);
-        setHints(Client::instance()->d_ptr->hints);
+        // we can take file lists without them being joined into one string
+        setHints(QStringList(Client::instance()->d_ptr->hints) << "supports-file-list=true");
     }
 
     connect(d->p, SIGNAL(Changed()),
@@ -104,6 +105,8 @@ Transaction::Transaction(const QString &tid, QObject *parent)
             d, SLOT(errorCode(const QString&, const QString&)));
     connect(d->p, SIGNAL(Files(const QString&, const QString&)),
             d, SLOT(files(const QString&, const QString&)));
+    connect(d->p, SIGNAL(FileList(const QString&, const QStringList&)),
+            d, SLOT(fileList(const QString&, const QStringList&)));
     connect(d->p, SIGNAL(Finished(const QString&, uint)),
             d, SLOT(finished(const QString&, uint)));
     connect(d->p, SIGNAL(Message(const QString&, const QString&)),
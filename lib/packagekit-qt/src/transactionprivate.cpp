@@ -83,6 +83,11 @@ void TransactionPrivate::files(const QString& pid, const QString& filenames)
 	t->files(QSharedPointer<Package> (new Package(pid)), filenames.split(";"));
 }
 
+void TransactionPrivate::fileList(const QString& pid, const QStringList& filenames)
+{
+	t->files(QSharedPointer<Package> (new Package(pid)), filenames);
+}
+
 void TransactionPrivate::finished(const QString& exitCode, uint runtime)
 {
 	int exitValue = Util::enumFromString<Enum>(exitCode, "Exit", "Exit");
@@ -64,6 +64,7 @@ public Q_SLOTS:
 	void eulaRequired(const QString& eulaId, const QString& pid, const QString& vendor, const QString& licenseAgreement);
 	void mediaChangeRequired(const QString& mediaType, const QString& mediaId, const QString& mediaText);
 	void files(const QString& pid, const QString& filenames);
+	void fileList(const QString& pid, const QStringList& filenames);
 	void finished(const QString& exitCode, uint runtime);
 	void message(const QString& type, const QString& message);
 	void package(const QString& info, const QString& pid, const QString& summary);
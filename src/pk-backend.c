@@ -86,6 +86,24 @@
  */
 #define PK_BACKEND_CANCEL_ACTION_TIMEOUT	2000 /* ms */
 
+/**
+ * PK_BACKEND_WORKER_THREADS:
+ *
+ * The maximum number of threads pk_backend_thread_foreach() runs items on.
+ * Most of the work backends split up is waiting on disk or network, so this
+ * does not need to match the number of processors.
+ */
+#define PK_BACKEND_WORKER_THREADS		4
+
+/**
+ * PK_BACKEND_PROGRESS_INTERVAL_DEFAULT:
+ *
+ * The time in ms progress and speed updates are merged over when
+ * ProgressInterval is not set in the config file. Status changes and
+ * finishing always send the last values straight away.
+ */
+#define PK_BACKEND_PROGRESS_INTERVAL_DEFAULT	100 /* ms */
+
 struct PkBackendPrivate
 {
 	gboolean		 during_initialize;
@@ -107,6 +125,8 @@ struct PkBackendPrivate
 	gchar			*proxy_http;
 	gchar			*root;
 	gpointer		 file_changed_data;
+	gchar			*files_package_id;
+	GPtrArray		*files_array;
 	guint			 download_files;
 	guint			 last_percentage;
 	guint			 last_remaining;
@@ -115,9 +135,18 @@ struct PkBackendPrivate
 	guint			 signal_finished;
 	guint			 speed;
 	guint			 cancel_id;
+	guint			 progress_interval;
+	guint			 progress_flush_id;
+	gboolean		 progress_pending;
+	gboolean		 speed_pending;
+	gdouble			 progress_last; /* ms */
+	GTimer			*progress_timer;
 	GHashTable		*eulas;
 	GModule			*handle;
-	GThread			*thread;
+	gboolean		 threaded;
+	gboolean		 cancelled;
+	GThreadPool		*thread_pool;
+	GStaticRecMutex		 emit_mutex;
 	PkBackendDesc		*desc;
 	PkBackendFileChanged	 file_changed_func;
 	PkHintEnum		 background;
@@ -129,7 +158,6 @@ struct PkBackendPrivate
 	PkFileMonitor		*file_monitor;
 	PkPackage		*last_package;
 	PkNetwork		*network;
-	PkResults		*results;
 	PkRoleEnum		 role; /* this never changes for the lifetime of a transaction */
 	PkRoleEnum		 transaction_role;
 	PkStatusEnum		 status; /* this changes */
@@ -230,6 +258,73 @@ pk_backend_get_role (PkBackend *backend)
 	return backend->priv->role;
 }
 
+/**
+ * pk_backend_get_request_key_sort_cb:
+ **/
+static gint
+pk_backend_get_request_key_sort_cb (const gchar **a, const gchar **b)
+{
+	return g_strcmp0 (*a, *b);
+}
+
+/**
+ * pk_backend_get_request_key:
+ *
+ * Gets a key for what the transaction was asked to do, made from the role
+ * and the sorted package IDs. The simulate roles use the role they simulate,
+ * so a simulation and the real transaction that follows it have the same
+ * key, and the backend can reuse what it worked out during the simulation.
+ *
+ * Return value: a new string, or %NULL if the role does not act on packages
+ **/
+gchar *
+pk_backend_get_request_key (PkBackend *backend)
+{
+	guint i;
+	guint length;
+	PkRoleEnum role;
+	gchar **package_ids;
+	GPtrArray *sorted = NULL;
+	GString *key = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+
+	role = backend->priv->role;
+	if (role == PK_ROLE_ENUM_SIMULATE_INSTALL_PACKAGES)
+		role = PK_ROLE_ENUM_INSTALL_PACKAGES;
+	else if (role == PK_ROLE_ENUM_SIMULATE_UPDATE_PACKAGES)
+		role = PK_ROLE_ENUM_UPDATE_PACKAGES;
+	else if (role == PK_ROLE_ENUM_SIMULATE_REMOVE_PACKAGES)
+		role = PK_ROLE_ENUM_REMOVE_PACKAGES;
+	else if (role != PK_ROLE_ENUM_INSTALL_PACKAGES &&
+		 role != PK_ROLE_ENUM_UPDATE_PACKAGES &&
+		 role != PK_ROLE_ENUM_REMOVE_PACKAGES)
+		goto out;
+
+	package_ids = pk_store_get_strv (backend->priv->store, "package_ids");
+	if (package_ids == NULL)
+		goto out;
+
+	/* the order the client gave them in does not matter */
+	length = g_strv_length (package_ids);
+	sorted = g_ptr_array_sized_new (length);
+	for (i=0; i<length; i++)
+		g_ptr_array_add (sorted, package_ids[i]);
+	g_ptr_array_sort (sorted, (GCompareFunc) pk_backend_get_request_key_sort_cb);
+
+	key = g_string_new (pk_role_enum_to_string (role));
+	if (role == PK_ROLE_ENUM_REMOVE_PACKAGES)
+		g_string_append (key, pk_store_get_bool (backend->priv->store, "autoremove") ? ";autoremove" : "");
+	for (i=0; i<sorted->len; i++) {
+		g_string_append_c (key, '&');
+		g_string_append (key, g_ptr_array_index (sorted, i));
+	}
+out:
+	if (sorted != NULL)
+		g_ptr_array_unref (sorted);
+	return key != NULL ? g_string_free (key, FALSE) : NULL;
+}
+
 /**
  * pk_backend_get_roles:
  **/
@@ -757,6 +852,80 @@ pk_backend_emit_progress_changed (PkBackend *backend)
 	return TRUE;
 }
 
+/**
+ * pk_backend_progress_flush:
+ *
+ * Sends the progress and speed updates that were held back.
+ **/
+static void
+pk_backend_progress_flush (PkBackend *backend)
+{
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
+	if (backend->priv->progress_flush_id != 0) {
+		g_source_remove (backend->priv->progress_flush_id);
+		backend->priv->progress_flush_id = 0;
+	}
+	if (backend->priv->progress_pending) {
+		backend->priv->progress_pending = FALSE;
+		pk_backend_emit_progress_changed (backend);
+	}
+	if (backend->priv->speed_pending) {
+		backend->priv->speed_pending = FALSE;
+		g_object_notify (G_OBJECT (backend), "speed");
+	}
+	backend->priv->progress_last = g_timer_elapsed (backend->priv->progress_timer, NULL) * 1000;
+
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
+}
+
+/**
+ * pk_backend_progress_flush_cb:
+ **/
+static gboolean
+pk_backend_progress_flush_cb (PkBackend *backend)
+{
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+	backend->priv->progress_flush_id = 0;
+	pk_backend_progress_flush (backend);
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
+	return FALSE;
+}
+
+/**
+ * pk_backend_progress_queue:
+ *
+ * Sends the update now if nothing was sent in the last progress interval,
+ * otherwise merges it with the others that arrive before the interval is up.
+ **/
+static void
+pk_backend_progress_queue (PkBackend *backend, gboolean speed)
+{
+	gdouble elapsed;
+
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
+	if (speed)
+		backend->priv->speed_pending = TRUE;
+	else
+		backend->priv->progress_pending = TRUE;
+
+	elapsed = g_timer_elapsed (backend->priv->progress_timer, NULL) * 1000 - backend->priv->progress_last;
+	if (elapsed >= backend->priv->progress_interval) {
+		pk_backend_progress_flush (backend);
+		goto out;
+	}
+
+	/* already waiting */
+	if (backend->priv->progress_flush_id != 0)
+		goto out;
+	backend->priv->progress_flush_id =
+		g_timeout_add (backend->priv->progress_interval - (guint) elapsed,
+			       (GSourceFunc) pk_backend_progress_flush_cb, backend);
+out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
+}
+
 /**
  * pk_backend_set_percentage:
  **/
@@ -814,8 +983,11 @@ pk_backend_set_percentage (PkBackend *backend, guint percentage)
 			backend->priv->last_remaining = remaining;
 	}
 
-	/* emit the progress changed signal */
-	pk_backend_emit_progress_changed (backend);
+	/* emit the progress changed signal, the start and end
+	 * of a step are never held back */
+	pk_backend_progress_queue (backend, FALSE);
+	if (percentage == 0 || percentage >= 100)
+		pk_backend_progress_flush (backend);
 	return TRUE;
 }
 
@@ -842,7 +1014,7 @@ pk_backend_set_speed (PkBackend *backend, guint speed)
 
 	/* set new value */
 	backend->priv->speed = speed;
-	g_object_notify (G_OBJECT (backend), "speed");
+	pk_backend_progress_queue (backend, TRUE);
 	return TRUE;
 }
 
@@ -859,6 +1031,21 @@ pk_backend_get_runtime (PkBackend *backend)
 	return pk_time_get_elapsed (backend->priv->time);
 }
 
+/**
+ * pk_backend_set_expected_runtime:
+ * @expected: how long the same action took before in ms, or 0 if unknown
+ *
+ * Lets the remaining time be estimated before the backend has sent
+ * enough progress for its own estimate.
+ **/
+gboolean
+pk_backend_set_expected_runtime (PkBackend *backend, guint expected)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+	g_debug ("expecting to run for %ims", expected);
+	return pk_time_set_expected (backend->priv->time, expected);
+}
+
 /**
  * pk_backend_set_sub_percentage:
  **/
@@ -890,7 +1077,7 @@ pk_backend_set_sub_percentage (PkBackend *backend, guint percentage)
 	backend->priv->last_subpercentage = percentage;
 
 	/* emit the progress changed signal */
-	pk_backend_emit_progress_changed (backend);
+	pk_backend_progress_queue (backend, FALSE);
 	return TRUE;
 }
 
@@ -923,6 +1110,9 @@ pk_backend_set_status (PkBackend *backend, PkStatusEnum status)
 		return FALSE;
 	}
 
+	/* the progress was for the old status */
+	pk_backend_progress_flush (backend);
+
 	/* do we have to enumate a running call? */
 	if (status != PK_STATUS_ENUM_RUNNING && status != PK_STATUS_ENUM_SETUP) {
 		if (backend->priv->status == PK_STATUS_ENUM_SETUP) {
@@ -1068,6 +1258,9 @@ pk_backend_package (PkBackend *backend, PkInfoEnum info, const gchar *package_id
 	g_return_val_if_fail (package_id != NULL, FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	/* backends may send results from several worker threads at once */
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* check we are valid */
 	ret = pk_package_id_check (package_id);
 	if (!ret) {
@@ -1145,13 +1338,10 @@ pk_backend_package (PkBackend *backend, PkInfoEnum info, const gchar *package_id
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_PACKAGE], 0, item);
 
-	/* add to results if meaningful */
-	if (info != PK_INFO_ENUM_FINISHED)
-		pk_results_add_package (backend->priv->results, item);
-
 	/* success */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	g_free (summary_safe);
@@ -1179,6 +1369,8 @@ pk_backend_update_detail (PkBackend *backend, const gchar *package_id,
 	g_return_val_if_fail (package_id != NULL, FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* have we already set an error? */
 	if (backend->priv->set_error) {
 		g_warning ("already set error, cannot process: update_detail %s", package_id);
@@ -1225,11 +1417,11 @@ pk_backend_update_detail (PkBackend *backend, const gchar *package_id,
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_UPDATE_DETAIL], 0, item);
-	pk_results_add_update_detail (backend->priv->results, item);
 
 	/* we parsed okay */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	g_free (update_text_safe);
@@ -1292,7 +1484,6 @@ pk_backend_require_restart (PkBackend *backend, PkRestartEnum restart, const gch
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_REQUIRE_RESTART], 0, item);
-	pk_results_add_require_restart (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
@@ -1316,6 +1507,8 @@ pk_backend_message (PkBackend *backend, PkMessageEnum message, const gchar *form
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* have we already set an error? */
 	if (backend->priv->set_error && message != PK_MESSAGE_ENUM_BACKEND_ERROR) {
 		g_warning ("already set error, cannot process: message %s", pk_message_enum_to_string (message));
@@ -1335,11 +1528,11 @@ pk_backend_message (PkBackend *backend, PkMessageEnum message, const gchar *form
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_MESSAGE], 0, item);
-	pk_results_add_message (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	g_free (buffer);
 	if (item != NULL)
 		g_object_unref (item);
@@ -1481,6 +1674,8 @@ pk_backend_details (PkBackend *backend, const gchar *package_id,
 	g_return_val_if_fail (package_id != NULL, FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* have we already set an error? */
 	if (backend->priv->set_error) {
 		g_warning ("already set error, cannot process: details %s", package_id);
@@ -1503,11 +1698,11 @@ pk_backend_details (PkBackend *backend, const gchar *package_id,
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_DETAILS], 0, item);
-	pk_results_add_details (backend->priv->results, item);
 
 	/* we parsed okay */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	g_free (description_safe);
@@ -1515,25 +1710,27 @@ out:
 }
 
 /**
- * pk_backend_files:
+ * pk_backend_files_strv:
  *
- * package_id is NULL when we are using this as a calback from DownloadPackages
+ * Emits the file list for a package without joining it into one string.
  **/
 gboolean
-pk_backend_files (PkBackend *backend, const gchar *package_id, const gchar *filelist)
+pk_backend_files_strv (PkBackend *backend, const gchar *package_id, gchar **files)
 {
 	gboolean ret;
 	PkFiles *item = NULL;
-	gchar **files = NULL;
 
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
-	g_return_val_if_fail (filelist != NULL, FALSE);
+	g_return_val_if_fail (files != NULL, FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* have we already set an error? */
 	if (backend->priv->set_error) {
 		g_warning ("already set error, cannot process: files %s", package_id);
-		return FALSE;
+		ret = FALSE;
+		goto out;
 	}
 
 	/* check we are valid */
@@ -1544,7 +1741,6 @@ pk_backend_files (PkBackend *backend, const gchar *package_id, const gchar *file
 	}
 
 	/* form PkFiles struct */
-	files = g_strsplit (filelist, ";", -1);
 	item = pk_files_new ();
 	g_object_set (item,
 		      "package-id", package_id,
@@ -1553,18 +1749,93 @@ pk_backend_files (PkBackend *backend, const gchar *package_id, const gchar *file
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_FILES], 0, item);
-	pk_results_add_files (backend->priv->results, item);
 
 	/* success */
 	backend->priv->download_files++;
 	ret = TRUE;
 out:
-	g_strfreev (files);
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	return ret;
 }
 
+/**
+ * pk_backend_files_flush:
+ *
+ * Emits any files added with pk_backend_files_add().
+ **/
+static void
+pk_backend_files_flush (PkBackend *backend)
+{
+	PkBackendPrivate *priv = backend->priv;
+
+	if (priv->files_package_id == NULL)
+		return;
+
+	/* add the NULL terminator and hand over the array as a strv */
+	g_ptr_array_add (priv->files_array, NULL);
+	if (!priv->set_error)
+		pk_backend_files_strv (backend, priv->files_package_id,
+				       (gchar **) priv->files_array->pdata);
+	g_ptr_array_set_size (priv->files_array, 0);
+	g_free (priv->files_package_id);
+	priv->files_package_id = NULL;
+}
+
+/**
+ * pk_backend_files_add:
+ *
+ * Adds one file to the list for package_id. Backends can call this as they
+ * walk the package file list, rather than building one big string; the list
+ * is emitted when a different package is added to or the backend finishes.
+ **/
+gboolean
+pk_backend_files_add (PkBackend *backend, const gchar *package_id, const gchar *file)
+{
+	PkBackendPrivate *priv = backend->priv;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+	g_return_val_if_fail (file != NULL, FALSE);
+	g_return_val_if_fail (priv->locked != FALSE, FALSE);
+
+	g_static_rec_mutex_lock (&priv->emit_mutex);
+
+	/* a new package, so send the last one */
+	if (g_strcmp0 (priv->files_package_id, package_id) != 0) {
+		pk_backend_files_flush (backend);
+		priv->files_package_id = g_strdup (package_id);
+	}
+
+	g_ptr_array_add (priv->files_array, g_strdup (file));
+	g_static_rec_mutex_unlock (&priv->emit_mutex);
+	return TRUE;
+}
+
+/**
+ * pk_backend_files:
+ *
+ * package_id is NULL when we are using this as a calback from DownloadPackages
+ **/
+gboolean
+pk_backend_files (PkBackend *backend, const gchar *package_id, const gchar *filelist)
+{
+	gboolean ret;
+	gchar **files;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+	g_return_val_if_fail (filelist != NULL, FALSE);
+
+	/* keep the order if the backend is also adding single files */
+	pk_backend_files_flush (backend);
+
+	files = g_strsplit (filelist, ";", -1);
+	ret = pk_backend_files_strv (backend, package_id, files);
+	g_strfreev (files);
+	return ret;
+}
+
 /**
  * pk_backend_distro_upgrade:
  **/
@@ -1602,7 +1873,6 @@ pk_backend_distro_upgrade (PkBackend *backend, PkDistroUpgradeEnum state, const
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_DISTRO_UPGRADE], 0, item);
-	pk_results_add_distro_upgrade (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
@@ -1657,7 +1927,6 @@ pk_backend_repo_signature_required (PkBackend *backend, const gchar *package_id,
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_REPO_SIGNATURE_REQUIRED], 0, item);
-	pk_results_add_repo_signature_required (backend->priv->results, item);
 
 	/* success */
 	backend->priv->set_signature = TRUE;
@@ -1708,7 +1977,6 @@ pk_backend_eula_required (PkBackend *backend, const gchar *eula_id, const gchar
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_EULA_REQUIRED], 0, item);
-	pk_results_add_eula_required (backend->priv->results, item);
 
 	/* success */
 	backend->priv->set_eula = TRUE;
@@ -1752,7 +2020,6 @@ pk_backend_media_change_required (PkBackend *backend,
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_MEDIA_CHANGE_REQUIRED], 0, item);
-	pk_results_add_media_change_required (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
@@ -1777,6 +2044,8 @@ pk_backend_repo_detail (PkBackend *backend, const gchar *repo_id,
 	g_return_val_if_fail (repo_id != NULL, FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* have we already set an error? */
 	if (backend->priv->set_error) {
 		g_warning ("already set error, cannot process: repo-detail %s", repo_id);
@@ -1796,11 +2065,11 @@ pk_backend_repo_detail (PkBackend *backend, const gchar *repo_id,
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_REPO_DETAIL], 0, item);
-	pk_results_add_repo_detail (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	g_free (description_safe);
@@ -1821,6 +2090,8 @@ pk_backend_category (PkBackend *backend, const gchar *parent_id, const gchar *ca
 	g_return_val_if_fail (cat_id != NULL, FALSE);
 	g_return_val_if_fail (backend->priv->locked != FALSE, FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	/* have we already set an error? */
 	if (backend->priv->set_error) {
 		g_warning ("already set error, cannot process: category %s", cat_id);
@@ -1842,11 +2113,11 @@ pk_backend_category (PkBackend *backend, const gchar *parent_id, const gchar *ca
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_CATEGORY], 0, item);
-	pk_results_add_category (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	g_free (summary_safe);
@@ -1964,6 +2235,8 @@ pk_backend_error_code (PkBackend *backend, PkErrorEnum error_code, const gchar *
 
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
 
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+
 	va_start (args, format);
 	buffer = g_strdup_vprintf (format, args);
 	va_end (args);
@@ -2006,11 +2279,11 @@ pk_backend_error_code (PkBackend *backend, PkErrorEnum error_code, const gchar *
 
 	/* emit */
 	g_signal_emit (backend, signals[SIGNAL_ERROR_CODE], 0, item);
-	pk_results_set_error_code (backend->priv->results, item);
 
 	/* success */
 	ret = TRUE;
 out:
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
 	if (item != NULL)
 		g_object_unref (item);
 	g_free (buffer);
@@ -2273,8 +2546,14 @@ pk_backend_finished (PkBackend *backend)
 		return FALSE;
 	}
 
+	/* send any file list still being built */
+	pk_backend_files_flush (backend);
+
+	/* and the last progress */
+	pk_backend_progress_flush (backend);
+
 	/* ensure threaded backends get stop vfuncs fired */
-	if (backend->priv->thread != NULL)
+	if (backend->priv->threaded)
 		pk_backend_transaction_stop (backend);
 
 	/* check we got a Package() else the UI will suck */
@@ -2441,8 +2720,8 @@ typedef struct {
 /**
  * pk_backend_thread_setup:
  **/
-static gpointer
-pk_backend_thread_setup (gpointer thread_data)
+static void
+pk_backend_thread_setup (gpointer thread_data, gpointer user_data)
 {
 	gboolean ret;
 	PkBackendThreadHelper *helper = (PkBackendThreadHelper *) thread_data;
@@ -2460,24 +2739,25 @@ pk_backend_thread_setup (gpointer thread_data)
 	/* destroy helper */
 	g_object_unref (helper->backend);
 	g_free (helper);
-
-	/* no return value */
-	return NULL;
 }
 
 /**
  * pk_backend_thread_create:
+ *
+ * Runs func in the backend thread. The thread is kept for the next
+ * transaction rather than being created each time.
  **/
 gboolean
 pk_backend_thread_create (PkBackend *backend, PkBackendThreadFunc func)
 {
 	gboolean ret = TRUE;
+	GError *error = NULL;
 	PkBackendThreadHelper *helper = NULL;
 
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
 	g_return_val_if_fail (func != NULL, FALSE);
 
-	if (backend->priv->thread != NULL) {
+	if (backend->priv->threaded) {
 		g_warning ("already has thread");
 		return FALSE;
 	}
@@ -2489,19 +2769,129 @@ pk_backend_thread_create (PkBackend *backend, PkBackendThreadFunc func)
 		goto out;
 	}
 
+	/* only one transaction runs at a time, so one thread is enough */
+	if (backend->priv->thread_pool == NULL) {
+		backend->priv->thread_pool = g_thread_pool_new (pk_backend_thread_setup, NULL,
+								1, FALSE, &error);
+		if (backend->priv->thread_pool == NULL) {
+			g_warning ("failed to create thread pool: %s", error->message);
+			g_error_free (error);
+			ret = FALSE;
+			goto out;
+		}
+	}
+
 	/* create a helper object to allow us to call a _setup() function */
 	helper = g_new0 (PkBackendThreadHelper, 1);
 	helper->backend = g_object_ref (backend);
 	helper->func = func;
 
-	/* create a thread */
-	backend->priv->thread = g_thread_create (pk_backend_thread_setup, helper, FALSE, NULL);
-	if (backend->priv->thread == NULL) {
-		g_warning ("failed to create thread");
-		ret = FALSE;
-		goto out;
+	/* run in the thread */
+	backend->priv->threaded = TRUE;
+	g_thread_pool_push (backend->priv->thread_pool, helper, NULL);
+out:
+	return ret;
+}
+
+/* shared state for the workers of one pk_backend_thread_foreach() */
+typedef struct {
+	PkBackend		*backend;
+	PkBackendWorkFunc	 func;
+	gpointer		 user_data;
+	guint			 total;
+	guint			 done;
+	gboolean		 ret;
+} PkBackendWorkHelper;
+
+/**
+ * pk_backend_thread_work_cb:
+ **/
+static void
+pk_backend_thread_work_cb (gpointer data, gpointer user_data)
+{
+	gboolean ret;
+	const gchar *item = (const gchar *) data;
+	PkBackendWorkHelper *helper = (PkBackendWorkHelper *) user_data;
+	PkBackend *backend = helper->backend;
+
+	/* don't start new work if we're going to throw it away */
+	if (backend->priv->cancelled || backend->priv->set_error) {
+		g_debug ("skipping %s", item);
+		return;
 	}
+
+	ret = helper->func (backend, item, helper->user_data);
+
+	/* the percentage is for the whole set of items */
+	g_static_rec_mutex_lock (&backend->priv->emit_mutex);
+	if (!ret)
+		helper->ret = FALSE;
+	helper->done++;
+	if (!backend->priv->set_error)
+		pk_backend_set_percentage (backend, helper->done * 100 / helper->total);
+	g_static_rec_mutex_unlock (&backend->priv->emit_mutex);
+}
+
+/**
+ * pk_backend_thread_foreach:
+ * @items: the package IDs, repo IDs or search terms to process
+ * @func: the function to run for each item
+ *
+ * Runs func for each item on up to PK_BACKEND_WORKER_THREADS threads, and
+ * returns when they have all completed. The backend functions that send
+ * results can be called from func, and the percentage is set as each item
+ * completes, so func should not set it. Items that have not started when
+ * the transaction is cancelled or an error is set are skipped.
+ *
+ * func must not touch backend state that is not safe to share between
+ * threads. If threads are not in use, the items are run in order.
+ *
+ * Return value: %FALSE if func returned %FALSE for any item
+ **/
+gboolean
+pk_backend_thread_foreach (PkBackend *backend, gchar **items, PkBackendWorkFunc func, gpointer user_data)
+{
+	guint i;
+	GError *error = NULL;
+	GThreadPool *pool = NULL;
+	PkBackendWorkHelper *helper;
+	gboolean ret;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+	g_return_val_if_fail (items != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	helper = g_new0 (PkBackendWorkHelper, 1);
+	helper->backend = backend;
+	helper->func = func;
+	helper->user_data = user_data;
+	helper->total = g_strv_length (items);
+	helper->ret = TRUE;
+
+	/* not worth using the pool */
+	if (!backend->priv->use_threads || helper->total < 2)
+		goto serial;
+
+	/* unused threads are shared between pools, so this is cheap */
+	pool = g_thread_pool_new (pk_backend_thread_work_cb, helper,
+				  PK_BACKEND_WORKER_THREADS, FALSE, &error);
+	if (pool == NULL) {
+		g_warning ("failed to create worker pool, running in order: %s", error->message);
+		g_error_free (error);
+		goto serial;
+	}
+	for (i=0; items[i] != NULL; i++)
+		g_thread_pool_push (pool, items[i], NULL);
+
+	/* wait for all the items to complete */
+	g_thread_pool_free (pool, FALSE, TRUE);
+	goto out;
+serial:
+	for (i=0; items[i] != NULL; i++)
+		pk_backend_thread_work_cb (items[i], helper);
 out:
+	ret = helper->ret;
+	g_free (helper);
 	return ret;
 }
 
@@ -2734,7 +3124,14 @@ pk_backend_finalize (GObject *object)
 	g_free (backend->priv->locale);
 	g_free (backend->priv->frontend_socket);
 	g_free (backend->priv->transaction_id);
-	g_object_unref (backend->priv->results);
+	g_free (backend->priv->files_package_id);
+	g_ptr_array_unref (backend->priv->files_array);
+	/* don't wait for the thread, as the last reference can be dropped
+	 * by pk_backend_thread_setup() running on it */
+	if (backend->priv->thread_pool != NULL)
+		g_thread_pool_free (backend->priv->thread_pool, FALSE, FALSE);
+	g_static_rec_mutex_free (&backend->priv->emit_mutex);
+	g_timer_destroy (backend->priv->progress_timer);
 	g_object_unref (backend->priv->time);
 	g_object_unref (backend->priv->network);
 	g_object_unref (backend->priv->store);
@@ -2933,6 +3330,16 @@ pk_backend_reset (PkBackend *backend)
 		backend->priv->signal_error_timeout = 0;
 	}
 
+	/* forget progress held back from the last transaction */
+	if (backend->priv->progress_flush_id != 0) {
+		g_source_remove (backend->priv->progress_flush_id);
+		backend->priv->progress_flush_id = 0;
+	}
+	backend->priv->progress_pending = FALSE;
+	backend->priv->speed_pending = FALSE;
+	backend->priv->progress_last = -(gdouble) backend->priv->progress_interval;
+	g_timer_start (backend->priv->progress_timer);
+
 	if (backend->priv->last_package != NULL) {
 		g_object_unref (backend->priv->last_package);
 		backend->priv->last_package = NULL;
@@ -2941,9 +3348,14 @@ pk_backend_reset (PkBackend *backend)
 	backend->priv->set_signature = FALSE;
 	backend->priv->set_eula = FALSE;
 	backend->priv->finished = FALSE;
+	backend->priv->simultaneous = FALSE;
 	backend->priv->has_sent_package = FALSE;
 	backend->priv->download_files = 0;
-	backend->priv->thread = NULL;
+	g_ptr_array_set_size (backend->priv->files_array, 0);
+	g_free (backend->priv->files_package_id);
+	backend->priv->files_package_id = NULL;
+	backend->priv->threaded = FALSE;
+	backend->priv->cancelled = FALSE;
 	backend->priv->last_package = NULL;
 	backend->priv->allow_cancel = PK_HINT_ENUM_UNSET;
 	backend->priv->status = PK_STATUS_ENUM_UNKNOWN;
@@ -2956,11 +3368,7 @@ pk_backend_reset (PkBackend *backend)
 	backend->priv->speed = 0;
 	pk_store_reset (backend->priv->store);
 	pk_time_reset (backend->priv->time);
-
-	/* unref then create rather then set zero size, as another object
-	 * might have a reference on the data */
-	g_object_unref (backend->priv->results);
-	backend->priv->results = pk_results_new ();
+	pk_time_set_expected (backend->priv->time, 0);
 
 	return TRUE;
 }
@@ -2989,6 +3397,9 @@ pk_backend_cancel (PkBackend *backend)
 {
 	g_return_if_fail (PK_IS_BACKEND (backend));
 
+	/* stop any workers picking up new items */
+	backend->priv->cancelled = TRUE;
+
 	/* call into the backend */
 	backend->priv->desc->cancel (backend);
 
@@ -3000,6 +3411,125 @@ pk_backend_cancel (PkBackend *backend)
 #endif
 }
 
+/**
+ * pk_backend_is_cancelled:
+ *
+ * Return value: %TRUE if the transaction has been cancelled, which long
+ * running backend work can check between items.
+ **/
+gboolean
+pk_backend_is_cancelled (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+	return backend->priv->cancelled;
+}
+
+/* package IDs interned against the native handles of a backend */
+struct _PkBackendPackageTable {
+	GHashTable		*by_handle;	/* handle -> package_id */
+	GHashTable		*by_id;		/* package_id -> handle */
+};
+
+/**
+ * pk_backend_package_table_new:
+ *
+ * Creates a table that lets a backend build the package ID of each native
+ * package once, when its package lists are loaded, instead of on every
+ * query. The table does not own the handles.
+ *
+ * Return value: a new #PkBackendPackageTable, free with pk_backend_package_table_free()
+ **/
+PkBackendPackageTable *
+pk_backend_package_table_new (void)
+{
+	PkBackendPackageTable *table;
+	table = g_new0 (PkBackendPackageTable, 1);
+	table->by_handle = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	table->by_id = g_hash_table_new (g_str_hash, g_str_equal);
+	return table;
+}
+
+/**
+ * pk_backend_package_table_add:
+ * @table: a valid #PkBackendPackageTable
+ * @handle: the native package, e.g. a pointer into the package list
+ * @package_id: the package ID of @handle
+ *
+ * Adds a package to the table. If two handles have the same package ID
+ * the first one added is returned by pk_backend_package_table_lookup().
+ *
+ * Return value: the package ID owned by the table, which is valid until
+ * the table is freed
+ **/
+const gchar *
+pk_backend_package_table_add (PkBackendPackageTable *table, gconstpointer handle, const gchar *package_id)
+{
+	gchar *id;
+
+	g_return_val_if_fail (table != NULL, NULL);
+	g_return_val_if_fail (handle != NULL, NULL);
+	g_return_val_if_fail (package_id != NULL, NULL);
+
+	/* already added */
+	id = g_hash_table_lookup (table->by_handle, handle);
+	if (id != NULL)
+		goto out;
+
+	id = g_strdup (package_id);
+	g_hash_table_insert (table->by_handle, (gpointer) handle, id);
+	if (g_hash_table_lookup (table->by_id, id) == NULL)
+		g_hash_table_insert (table->by_id, id, (gpointer) handle);
+out:
+	return id;
+}
+
+/**
+ * pk_backend_package_table_get_id:
+ * @table: a valid #PkBackendPackageTable
+ * @handle: the native package
+ *
+ * Return value: the package ID of @handle, or %NULL if it was not added.
+ * The string is owned by the table and must not be freed.
+ **/
+const gchar *
+pk_backend_package_table_get_id (PkBackendPackageTable *table, gconstpointer handle)
+{
+	g_return_val_if_fail (table != NULL, NULL);
+	return g_hash_table_lookup (table->by_handle, handle);
+}
+
+/**
+ * pk_backend_package_table_lookup:
+ * @table: a valid #PkBackendPackageTable
+ * @package_id: a package ID, e.g. from the client
+ *
+ * Return value: the native package with exactly this package ID, or %NULL
+ **/
+gpointer
+pk_backend_package_table_lookup (PkBackendPackageTable *table, const gchar *package_id)
+{
+	g_return_val_if_fail (table != NULL, NULL);
+	if (package_id == NULL)
+		return NULL;
+	return g_hash_table_lookup (table->by_id, package_id);
+}
+
+/**
+ * pk_backend_package_table_free:
+ * @table: a #PkBackendPackageTable, or %NULL
+ *
+ * Frees the table and the package IDs it owns, but not the handles.
+ **/
+void
+pk_backend_package_table_free (PkBackendPackageTable *table)
+{
+	if (table == NULL)
+		return;
+	g_hash_table_destroy (table->by_id);
+	g_hash_table_destroy (table->by_handle);
+	g_free (table);
+}
+
 /**
  * pk_backend_download_packages:
  */
@@ -3408,12 +3938,15 @@ static void
 pk_backend_init (PkBackend *backend)
 {
 	PkConf *conf;
+	gint interval;
 
 	backend->priv = PK_BACKEND_GET_PRIVATE (backend);
 	backend->priv->handle = NULL;
 	backend->priv->name = NULL;
 	backend->priv->locale = NULL;
 	backend->priv->frontend_socket = NULL;
+	backend->priv->files_package_id = NULL;
+	backend->priv->files_array = g_ptr_array_new_with_free_func (g_free);
 	backend->priv->cache_age = 0;
 	backend->priv->transaction_id = NULL;
 	backend->priv->proxy_http = NULL;
@@ -3424,15 +3957,18 @@ pk_backend_init (PkBackend *backend)
 	backend->priv->last_package = NULL;
 	backend->priv->locked = FALSE;
 	backend->priv->use_threads = FALSE;
+	backend->priv->thread_pool = NULL;
+	g_static_rec_mutex_init (&backend->priv->emit_mutex);
 	backend->priv->signal_finished = 0;
 	backend->priv->cancel_id = 0;
 	backend->priv->speed = 0;
+	backend->priv->progress_flush_id = 0;
+	backend->priv->progress_timer = g_timer_new ();
 	backend->priv->signal_error_timeout = 0;
 	backend->priv->during_initialize = FALSE;
 	backend->priv->simultaneous = FALSE;
 	backend->priv->roles = 0;
 	backend->priv->conf = pk_conf_new ();
-	backend->priv->results = pk_results_new ();
 	backend->priv->store = pk_store_new ();
 	backend->priv->time = pk_time_new ();
 	backend->priv->network = pk_network_new ();
@@ -3447,6 +3983,10 @@ pk_backend_init (PkBackend *backend)
 	conf = pk_conf_new ();
 	backend->priv->use_time = pk_conf_get_bool (conf, "UseRemainingTimeEstimation");
 	backend->priv->use_threads = pk_conf_get_bool (conf, "UseThreadsInBackend");
+	interval = pk_conf_get_int (conf, "ProgressInterval");
+	if (interval == PK_CONF_VALUE_INT_MISSING || interval < 0)
+		interval = PK_BACKEND_PROGRESS_INTERVAL_DEFAULT;
+	backend->priv->progress_interval = interval;
 	g_object_unref (conf);
 
 	pk_backend_reset (backend);
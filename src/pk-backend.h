@@ -198,6 +198,7 @@ gboolean	 pk_backend_is_eula_valid		(PkBackend	*backend,
 gboolean	 pk_backend_set_role			(PkBackend	*backend,
 							 PkRoleEnum	 role);
 PkRoleEnum	 pk_backend_get_role			(PkBackend	*backend);
+gchar		*pk_backend_get_request_key		(PkBackend	*backend);
 gboolean	 pk_backend_set_status			(PkBackend	*backend,
 							 PkStatusEnum	 status);
 gboolean	 pk_backend_set_allow_cancel		(PkBackend	*backend,
@@ -230,6 +231,8 @@ gboolean	 pk_backend_get_progress		(PkBackend	*backend,
 							 guint		*elapsed,
 							 guint		*remaining);
 guint		 pk_backend_get_runtime			(PkBackend	*backend);
+gboolean	 pk_backend_set_expected_runtime	(PkBackend	*backend,
+							 guint		 expected);
 gchar		*pk_backend_get_proxy_ftp		(PkBackend	*backend);
 gchar		*pk_backend_get_proxy_http		(PkBackend	*backend);
 const gchar	*pk_backend_get_root			(PkBackend	*backend);
@@ -276,6 +279,12 @@ gboolean	 pk_backend_details			(PkBackend	*backend,
 gboolean 	 pk_backend_files 			(PkBackend 	*backend,
 							 const gchar	*package_id,
 							 const gchar 	*filelist);
+gboolean	 pk_backend_files_strv			(PkBackend	*backend,
+							 const gchar	*package_id,
+							 gchar		**files);
+gboolean	 pk_backend_files_add			(PkBackend	*backend,
+							 const gchar	*package_id,
+							 const gchar	*file);
 gboolean 	 pk_backend_distro_upgrade		(PkBackend 	*backend,
 							 PkDistroUpgradeEnum type,
 							 const gchar 	*name,
@@ -351,6 +360,26 @@ typedef gboolean (*PkBackendThreadFunc)			(PkBackend	*backend);
 gboolean	 pk_backend_thread_create		(PkBackend	*backend,
 							 PkBackendThreadFunc func);
 void		 pk_backend_thread_finished		(PkBackend	*backend);
+typedef gboolean (*PkBackendWorkFunc)			(PkBackend	*backend,
+							 const gchar	*item,
+							 gpointer	 user_data);
+gboolean	 pk_backend_thread_foreach		(PkBackend	*backend,
+							 gchar		**items,
+							 PkBackendWorkFunc func,
+							 gpointer	 user_data);
+gboolean	 pk_backend_is_cancelled		(PkBackend	*backend);
+
+/* package IDs for the native packages of a backend */
+typedef struct _PkBackendPackageTable PkBackendPackageTable;
+PkBackendPackageTable *pk_backend_package_table_new	(void);
+const gchar	*pk_backend_package_table_add		(PkBackendPackageTable *table,
+							 gconstpointer	 handle,
+							 const gchar	*package_id);
+const gchar	*pk_backend_package_table_get_id	(PkBackendPackageTable *table,
+							 gconstpointer	 handle);
+gpointer	 pk_backend_package_table_lookup	(PkBackendPackageTable *table,
+							 const gchar	*package_id);
+void		 pk_backend_package_table_free		(PkBackendPackageTable *table);
 
 gboolean	 pk_backend_is_online			(PkBackend	*backend);
 gboolean	 pk_backend_use_background		(PkBackend	*backend);
@@ -48,6 +48,7 @@
 
 #include "pk-network.h"
 #include "pk-cache.h"
+#include "pk-file-index.h"
 #include "pk-shared.h"
 #include "pk-backend.h"
 #include "pk-engine.h"
@@ -74,6 +75,7 @@ struct PkEnginePrivate
 	PkTransactionList	*transaction_list;
 	PkTransactionDb		*transaction_db;
 	PkCache			*cache;
+	PkFileIndex		*file_index;
 	PkBackend		*backend;
 	PkInhibit		*inhibit;
 	PkNetwork		*network;
@@ -354,6 +356,9 @@ pk_engine_state_changed_cb (gpointer data)
 	g_debug ("unreffing updates cache as state may have changed");
 	pk_cache_invalidate (engine->priv->cache);
 
+	/* another tool may have installed or removed packages */
+	pk_file_index_invalidate (engine->priv->file_index);
+
 	pk_notify_updates_changed (engine->priv->notify);
 
 	/* reset, now valid */
@@ -1455,11 +1460,21 @@ pk_engine_init (PkEngine *engine)
 	if (pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_DEPENDS))
 		pk_bitfield_add (engine->priv->roles, PK_ROLE_ENUM_SIMULATE_UPDATE_PACKAGES);
 
+	/* the read-only queries can be run together as a batch */
+	if (pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_RESOLVE) ||
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_DETAILS) ||
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_UPDATE_DETAIL) ||
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_FILES))
+		pk_bitfield_add (engine->priv->roles, PK_ROLE_ENUM_BATCH);
+
 	engine->priv->timer = g_timer_new ();
 
 	/* we save a cache of the latest update lists sowe can do cached responses */
 	engine->priv->cache = pk_cache_new ();
 
+	/* keep the installed file owners between transactions */
+	engine->priv->file_index = pk_file_index_new ();
+
 	/* we need the uid and the session for the proxy setting mechanism */
 	engine->priv->dbus = pk_dbus_new ();
 
@@ -1585,6 +1600,7 @@ pk_engine_finalize (GObject *object)
 	g_object_unref (engine->priv->notify);
 	g_object_unref (engine->priv->backend);
 	g_object_unref (engine->priv->cache);
+	g_object_unref (engine->priv->file_index);
 	g_object_unref (engine->priv->conf);
 	g_object_unref (engine->priv->dbus);
 	g_free (engine->priv->mime_types);
@@ -0,0 +1,291 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+#include <packagekit-glib2/pk-package-id.h>
+
+#include "pk-file-index.h"
+
+#define PK_FILE_INDEX_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_FILE_INDEX, PkFileIndexPrivate))
+
+/**
+ * PkFileIndexPrivate:
+ *
+ * Maps the files of installed packages to the package_id that owns them.
+ * The package_id strings are owned by the packages table, and the files
+ * table only points to them.
+ **/
+struct PkFileIndexPrivate
+{
+	GHashTable		*files;		/* filename -> package_id */
+	GHashTable		*packages;	/* package_id -> GPtrArray of filenames */
+	gboolean		 populated;
+};
+
+G_DEFINE_TYPE (PkFileIndex, pk_file_index, G_TYPE_OBJECT)
+static gpointer pk_file_index_object = NULL;
+
+/**
+ * pk_file_index_get_populated:
+ *
+ * Return value: %TRUE if the index holds all the installed packages
+ **/
+gboolean
+pk_file_index_get_populated (PkFileIndex *index)
+{
+	g_return_val_if_fail (PK_IS_FILE_INDEX (index), FALSE);
+	return index->priv->populated;
+}
+
+/**
+ * pk_file_index_set_populated:
+ **/
+void
+pk_file_index_set_populated (PkFileIndex *index, gboolean populated)
+{
+	g_return_if_fail (PK_IS_FILE_INDEX (index));
+	index->priv->populated = populated;
+}
+
+/**
+ * pk_file_index_remove_package:
+ *
+ * Return value: %TRUE if the package was in the index
+ **/
+gboolean
+pk_file_index_remove_package (PkFileIndex *index, const gchar *package_id)
+{
+	GPtrArray *array;
+	const gchar *filename;
+	const gchar *owner;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_FILE_INDEX (index), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	array = g_hash_table_lookup (index->priv->packages, package_id);
+	if (array == NULL)
+		return FALSE;
+
+	/* only drop the files that another package has not taken over */
+	for (i=0; i<array->len; i++) {
+		filename = g_ptr_array_index (array, i);
+		owner = g_hash_table_lookup (index->priv->files, filename);
+		if (g_strcmp0 (owner, package_id) == 0)
+			g_hash_table_remove (index->priv->files, filename);
+	}
+	g_hash_table_remove (index->priv->packages, package_id);
+	return TRUE;
+}
+
+/**
+ * pk_file_index_remove_older:
+ * @package_id: the package_id of the package that has just been updated
+ *
+ * Removes all the packages with the same name and arch, but a different
+ * version, as they have been replaced by @package_id.
+ *
+ * Return value: %TRUE if any package was removed
+ **/
+gboolean
+pk_file_index_remove_older (PkFileIndex *index, const gchar *package_id)
+{
+	GHashTableIter iter;
+	GPtrArray *older;
+	gchar **split;
+	gchar **split_tmp;
+	const gchar *package_id_tmp;
+	gboolean ret = FALSE;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_FILE_INDEX (index), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	split = pk_package_id_split (package_id);
+	if (split == NULL)
+		return FALSE;
+
+	/* find them first, as we can't remove while iterating */
+	older = g_ptr_array_new_with_free_func (g_free);
+	g_hash_table_iter_init (&iter, index->priv->packages);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &package_id_tmp, NULL)) {
+		split_tmp = pk_package_id_split (package_id_tmp);
+		if (split_tmp == NULL)
+			continue;
+		if (g_strcmp0 (split[PK_PACKAGE_ID_NAME], split_tmp[PK_PACKAGE_ID_NAME]) == 0 &&
+		    g_strcmp0 (split[PK_PACKAGE_ID_ARCH], split_tmp[PK_PACKAGE_ID_ARCH]) == 0 &&
+		    g_strcmp0 (split[PK_PACKAGE_ID_VERSION], split_tmp[PK_PACKAGE_ID_VERSION]) != 0)
+			g_ptr_array_add (older, g_strdup (package_id_tmp));
+		g_strfreev (split_tmp);
+	}
+
+	for (i=0; i<older->len; i++) {
+		package_id_tmp = g_ptr_array_index (older, i);
+		g_debug ("removing %s as replaced by %s", package_id_tmp, package_id);
+		pk_file_index_remove_package (index, package_id_tmp);
+		ret = TRUE;
+	}
+
+	g_ptr_array_unref (older);
+	g_strfreev (split);
+	return ret;
+}
+
+/**
+ * pk_file_index_add_files:
+ *
+ * Adds the files owned by a package, replacing any files we already had
+ * for this package_id.
+ **/
+void
+pk_file_index_add_files (PkFileIndex *index, const gchar *package_id, gchar **files)
+{
+	GPtrArray *array;
+	gchar *package_id_tmp;
+	guint i;
+
+	g_return_if_fail (PK_IS_FILE_INDEX (index));
+	g_return_if_fail (package_id != NULL);
+	g_return_if_fail (files != NULL);
+
+	pk_file_index_remove_package (index, package_id);
+
+	package_id_tmp = g_strdup (package_id);
+	array = g_ptr_array_new_with_free_func (g_free);
+	g_hash_table_insert (index->priv->packages, package_id_tmp, array);
+
+	for (i=0; files[i] != NULL; i++) {
+		g_ptr_array_add (array, g_strdup (files[i]));
+		g_hash_table_replace (index->priv->files, g_ptr_array_index (array, i), package_id_tmp);
+	}
+}
+
+/**
+ * pk_file_index_lookup:
+ *
+ * Return value: the package_id owning @filename, or %NULL if not known
+ **/
+const gchar *
+pk_file_index_lookup (PkFileIndex *index, const gchar *filename)
+{
+	g_return_val_if_fail (PK_IS_FILE_INDEX (index), NULL);
+	g_return_val_if_fail (filename != NULL, NULL);
+	return g_hash_table_lookup (index->priv->files, filename);
+}
+
+/**
+ * pk_file_index_resolve:
+ *
+ * Return value: an array with the owning package_id, or %NULL, for each
+ * filename in the same order. Free with g_ptr_array_unref()
+ **/
+GPtrArray *
+pk_file_index_resolve (PkFileIndex *index, gchar **filenames)
+{
+	GPtrArray *array;
+	const gchar *package_id;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_FILE_INDEX (index), NULL);
+	g_return_val_if_fail (filenames != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func (g_free);
+	for (i=0; filenames[i] != NULL; i++) {
+		package_id = g_hash_table_lookup (index->priv->files, filenames[i]);
+		g_ptr_array_add (array, g_strdup (package_id));
+	}
+	return array;
+}
+
+/**
+ * pk_file_index_invalidate:
+ *
+ * Forget everything, e.g. when the package database was changed behind
+ * our back.
+ **/
+void
+pk_file_index_invalidate (PkFileIndex *index)
+{
+	g_return_if_fail (PK_IS_FILE_INDEX (index));
+
+	g_debug ("invalidating file index");
+	g_hash_table_remove_all (index->priv->files);
+	g_hash_table_remove_all (index->priv->packages);
+	index->priv->populated = FALSE;
+}
+
+/**
+ * pk_file_index_finalize:
+ **/
+static void
+pk_file_index_finalize (GObject *object)
+{
+	PkFileIndex *index;
+	g_return_if_fail (PK_IS_FILE_INDEX (object));
+	index = PK_FILE_INDEX (object);
+
+	g_hash_table_unref (index->priv->files);
+	g_hash_table_unref (index->priv->packages);
+
+	G_OBJECT_CLASS (pk_file_index_parent_class)->finalize (object);
+}
+
+/**
+ * pk_file_index_class_init:
+ **/
+static void
+pk_file_index_class_init (PkFileIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_file_index_finalize;
+	g_type_class_add_private (klass, sizeof (PkFileIndexPrivate));
+}
+
+/**
+ * pk_file_index_init:
+ **/
+static void
+pk_file_index_init (PkFileIndex *index)
+{
+	index->priv = PK_FILE_INDEX_GET_PRIVATE (index);
+	index->priv->files = g_hash_table_new (g_str_hash, g_str_equal);
+	index->priv->packages = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_ptr_array_unref);
+	index->priv->populated = FALSE;
+}
+
+/**
+ * pk_file_index_new:
+ * Return value: A new file index class instance.
+ **/
+PkFileIndex *
+pk_file_index_new (void)
+{
+	if (pk_file_index_object != NULL) {
+		g_object_ref (pk_file_index_object);
+	} else {
+		pk_file_index_object = g_object_new (PK_TYPE_FILE_INDEX, NULL);
+		g_object_add_weak_pointer (pk_file_index_object, &pk_file_index_object);
+	}
+	return PK_FILE_INDEX (pk_file_index_object);
+}
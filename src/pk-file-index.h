@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PK_FILE_INDEX_H
+#define __PK_FILE_INDEX_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define PK_TYPE_FILE_INDEX		(pk_file_index_get_type ())
+#define PK_FILE_INDEX(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), PK_TYPE_FILE_INDEX, PkFileIndex))
+#define PK_FILE_INDEX_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), PK_TYPE_FILE_INDEX, PkFileIndexClass))
+#define PK_IS_FILE_INDEX(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), PK_TYPE_FILE_INDEX))
+#define PK_IS_FILE_INDEX_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), PK_TYPE_FILE_INDEX))
+#define PK_FILE_INDEX_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), PK_TYPE_FILE_INDEX, PkFileIndexClass))
+
+typedef struct PkFileIndexPrivate PkFileIndexPrivate;
+
+typedef struct
+{
+	GObject			 parent;
+	PkFileIndexPrivate	*priv;
+} PkFileIndex;
+
+typedef struct
+{
+	GObjectClass	parent_class;
+} PkFileIndexClass;
+
+GType		 pk_file_index_get_type		(void);
+PkFileIndex	*pk_file_index_new		(void);
+
+gboolean	 pk_file_index_get_populated	(PkFileIndex	*index);
+void		 pk_file_index_set_populated	(PkFileIndex	*index,
+						 gboolean	 populated);
+void		 pk_file_index_add_files	(PkFileIndex	*index,
+						 const gchar	*package_id,
+						 gchar		**files);
+gboolean	 pk_file_index_remove_package	(PkFileIndex	*index,
+						 const gchar	*package_id);
+gboolean	 pk_file_index_remove_older	(PkFileIndex	*index,
+						 const gchar	*package_id);
+const gchar	*pk_file_index_lookup		(PkFileIndex	*index,
+						 const gchar	*filename);
+GPtrArray	*pk_file_index_resolve		(PkFileIndex	*index,
+						 gchar		**filenames);
+void		 pk_file_index_invalidate	(PkFileIndex	*index);
+
+G_END_DECLS
+
+#endif /* __PK_FILE_INDEX_H */
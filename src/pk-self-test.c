@@ -31,6 +31,7 @@
 #include "pk-conf.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
+#include "pk-file-index.h"
 #include "pk-file-monitor.h"
 #include "pk-inhibit.h"
 #include "pk-lsof.h"
@@ -112,6 +113,7 @@ _g_test_loop_quit (void)
 
 static guint number_messages = 0;
 static guint number_packages = 0;
+static guint number_progress = 0;
 
 /**
  * pk_test_backend_message_cb:
@@ -159,6 +161,24 @@ pk_test_backend_func_immediate_false (PkBackend *backend)
 	return FALSE;
 }
 
+static gboolean
+pk_test_backend_work_func (PkBackend *backend, const gchar *item, gpointer user_data)
+{
+	pk_backend_package (backend, PK_INFO_ENUM_AVAILABLE, item, "Test package");
+	return TRUE;
+}
+
+/**
+ * pk_test_backend_progress_changed_cb:
+ **/
+static void
+pk_test_backend_progress_changed_cb (PkBackend *backend, guint percentage, guint subpercentage,
+				     guint elapsed, guint remaining, gpointer user_data)
+{
+	g_debug ("percentage:%i", percentage);
+	number_progress++;
+}
+
 /**
  * pk_test_backend_package_cb:
  **/
@@ -179,6 +199,13 @@ pk_test_backend_func (void)
 	gboolean ret;
 	const gchar *filename;
 	gboolean developer_mode;
+	gchar **package_ids;
+	gint progress_interval;
+	PkBackendPackageTable *table;
+	const gchar *package_id;
+	gint handles[2];
+	gchar *key;
+	gchar *key_simulate;
 
 	/* get an backend */
 	backend = pk_backend_new ();
@@ -292,6 +319,86 @@ pk_test_backend_func (void)
 	/* wait for Finished */
 	_g_test_loop_wait (10);
 
+	/* run some work on each of the workers */
+	pk_backend_reset (backend);
+	package_ids = g_strsplit ("powertop;1.8-1.fc8;i386;fedora&"
+				  "gnome-power-manager;2.6.19;i386;fedora&"
+				  "kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed", "&", -1);
+	ret = pk_backend_thread_foreach (backend, package_ids, pk_test_backend_work_func, NULL);
+	g_assert (ret);
+	g_strfreev (package_ids);
+
+	/* check we got them all */
+	g_assert_cmpint (number_packages, ==, 4);
+
+	/* package IDs are built once and map back to the native package */
+	table = pk_backend_package_table_new ();
+	package_id = pk_backend_package_table_add (table, &handles[0], "powertop;1.8-1.fc8;i386;fedora");
+	g_assert_cmpstr (package_id, ==, "powertop;1.8-1.fc8;i386;fedora");
+	g_assert (pk_backend_package_table_add (table, &handles[0], "powertop;1.8-1.fc8;i386;fedora") == package_id);
+	pk_backend_package_table_add (table, &handles[1], "kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed");
+	g_assert (pk_backend_package_table_get_id (table, &handles[0]) == package_id);
+	g_assert (pk_backend_package_table_lookup (table, "kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed") == &handles[1]);
+	g_assert (pk_backend_package_table_lookup (table, "kernel;2.6.23-0.115.rc3.git1.fc8;i386;fedora") == NULL);
+	pk_backend_package_table_free (table);
+
+	/* a simulation has the same request key as the real transaction */
+	pk_backend_reset (backend);
+	pk_backend_set_role (backend, PK_ROLE_ENUM_SIMULATE_INSTALL_PACKAGES);
+	package_ids = g_strsplit ("powertop;1.8-1.fc8;i386;fedora&"
+				  "kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed", "&", -1);
+	pk_backend_set_strv (backend, "package_ids", package_ids);
+	g_strfreev (package_ids);
+	key_simulate = pk_backend_get_request_key (backend);
+	g_assert (key_simulate != NULL);
+
+	/* the order of the package IDs does not matter */
+	pk_backend_reset (backend);
+	pk_backend_set_role (backend, PK_ROLE_ENUM_INSTALL_PACKAGES);
+	package_ids = g_strsplit ("kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed&"
+				  "powertop;1.8-1.fc8;i386;fedora", "&", -1);
+	pk_backend_set_strv (backend, "package_ids", package_ids);
+	key = pk_backend_get_request_key (backend);
+	g_assert_cmpstr (key, ==, key_simulate);
+	g_free (key);
+
+	/* but the role does */
+	pk_backend_reset (backend);
+	pk_backend_set_role (backend, PK_ROLE_ENUM_UPDATE_PACKAGES);
+	pk_backend_set_strv (backend, "package_ids", package_ids);
+	g_strfreev (package_ids);
+	key = pk_backend_get_request_key (backend);
+	g_assert_cmpstr (key, !=, key_simulate);
+	g_free (key);
+	g_free (key_simulate);
+	pk_backend_reset (backend);
+
+	/* progress updates sent close together are merged */
+	conf = pk_conf_new ();
+	progress_interval = pk_conf_get_int (conf, "ProgressInterval");
+	g_object_unref (conf);
+	if (progress_interval != 0) {
+		pk_backend_reset (backend);
+		g_signal_connect (backend, "progress-changed",
+				  G_CALLBACK (pk_test_backend_progress_changed_cb), NULL);
+		pk_backend_set_percentage (backend, 10);
+		pk_backend_set_percentage (backend, 20);
+		pk_backend_set_percentage (backend, 30);
+		pk_backend_set_sub_percentage (backend, 50);
+		g_assert_cmpint (number_progress, ==, 1);
+
+		/* the last values are sent once the interval is up */
+		_g_test_loop_wait (1000);
+		g_assert_cmpint (number_progress, ==, 2);
+
+		/* and straight away when the status changes */
+		pk_backend_set_percentage (backend, 40);
+		pk_backend_set_percentage (backend, 50);
+		g_assert_cmpint (number_progress, ==, 3);
+		pk_backend_set_status (backend, PK_STATUS_ENUM_DOWNLOAD);
+		g_assert_cmpint (number_progress, ==, 4);
+	}
+
 	pk_backend_reset (backend);
 	pk_backend_error_code (backend, PK_ERROR_ENUM_GPG_FAILURE, "test error");
 
@@ -532,6 +639,58 @@ pk_test_cache_func (void)
 	g_object_unref (cache);
 }
 
+static void
+pk_test_file_index_func (void)
+{
+	PkFileIndex *index;
+	GPtrArray *array;
+	gboolean ret;
+	gchar *files_old[] = { "/usr/bin/foo", "/usr/lib/libfoo.so.1", NULL };
+	gchar *files_new[] = { "/usr/bin/foo", "/usr/lib/libfoo.so.2", NULL };
+	gchar *files_bar[] = { "/usr/bin/bar", NULL };
+	gchar *search[] = { "/usr/lib/libfoo.so.2", "/usr/bin/baz", "/usr/bin/bar", NULL };
+
+	index = pk_file_index_new ();
+	g_assert (index != NULL);
+	g_assert (!pk_file_index_get_populated (index));
+
+	/* add some packages */
+	pk_file_index_add_files (index, "foo;0.1;i386;installed", files_old);
+	pk_file_index_add_files (index, "bar;1.0;i386;installed", files_bar);
+	pk_file_index_set_populated (index, TRUE);
+	g_assert_cmpstr (pk_file_index_lookup (index, "/usr/bin/foo"), ==, "foo;0.1;i386;installed");
+	g_assert_cmpstr (pk_file_index_lookup (index, "/usr/bin/baz"), ==, NULL);
+
+	/* update foo, and remove the old version */
+	pk_file_index_add_files (index, "foo;0.2;i386;installed", files_new);
+	ret = pk_file_index_remove_older (index, "foo;0.2;i386;installed");
+	g_assert (ret);
+	g_assert_cmpstr (pk_file_index_lookup (index, "/usr/bin/foo"), ==, "foo;0.2;i386;installed");
+	g_assert_cmpstr (pk_file_index_lookup (index, "/usr/lib/libfoo.so.1"), ==, NULL);
+
+	/* resolve in one go */
+	array = pk_file_index_resolve (index, search);
+	g_assert_cmpint (array->len, ==, 3);
+	g_assert_cmpstr (g_ptr_array_index (array, 0), ==, "foo;0.2;i386;installed");
+	g_assert_cmpstr (g_ptr_array_index (array, 1), ==, NULL);
+	g_assert_cmpstr (g_ptr_array_index (array, 2), ==, "bar;1.0;i386;installed");
+	g_ptr_array_unref (array);
+
+	/* remove bar */
+	ret = pk_file_index_remove_package (index, "bar;1.0;i386;installed");
+	g_assert (ret);
+	g_assert_cmpstr (pk_file_index_lookup (index, "/usr/bin/bar"), ==, NULL);
+	ret = pk_file_index_remove_package (index, "bar;1.0;i386;installed");
+	g_assert (!ret);
+
+	/* invalidate */
+	pk_file_index_invalidate (index);
+	g_assert (!pk_file_index_get_populated (index));
+	g_assert_cmpstr (pk_file_index_lookup (index, "/usr/bin/foo"), ==, NULL);
+
+	g_object_unref (index);
+}
+
 static void
 pk_test_conf_func (void)
 {
@@ -1243,6 +1402,33 @@ pk_test_time_func (void)
 	g_assert_cmpint (value, >=, 1199);
 	g_assert_cmpint (value, <=, 1201);
 
+	/* reset */
+	g_object_unref (pktime);
+	pktime = pk_time_new ();
+
+	/* use the expected time when there is no data at all */
+	pk_time_set_expected (pktime, 20*1000);
+	value = pk_time_get_remaining (pktime);
+	g_assert_cmpint (value, >=, 19);
+	g_assert_cmpint (value, <=, 20);
+
+	/* use the expected time when there are no samples */
+	pk_time_add_data (pktime, 50);
+	value = pk_time_get_remaining (pktime);
+	g_assert_cmpint (value, >=, 9);
+	g_assert_cmpint (value, <=, 10);
+
+	/* blend it with the samples we get, which on their own say 21s */
+	value = 52;
+	while (value < 60) {
+		pk_time_advance_clock (pktime, 1000);
+		pk_time_add_data (pktime, value);
+		value += 2;
+	}
+	value = pk_time_get_remaining (pktime);
+	g_assert_cmpint (value, >, 8);
+	g_assert_cmpint (value, <, 21);
+
 	g_object_unref (pktime);
 }
 
@@ -1406,6 +1592,22 @@ pk_test_transaction_db_func (void)
 	g_assert_cmpint (value, >, 1);
 	g_assert_cmpint (value, <=, 4);
 
+	/* do we get no duration on a blank database */
+	value = pk_transaction_db_get_duration (db, PK_ROLE_ENUM_INSTALL_PACKAGES, "dummy", 2);
+	g_assert_cmpint (value, ==, 0);
+
+	/* is the duration kept per package */
+	ret = pk_transaction_db_add_duration (db, PK_ROLE_ENUM_INSTALL_PACKAGES, "dummy", 2, 4000);
+	g_assert (ret);
+	value = pk_transaction_db_get_duration (db, PK_ROLE_ENUM_INSTALL_PACKAGES, "dummy", 3);
+	g_assert_cmpint (value, ==, 6000);
+
+	/* is the duration averaged */
+	ret = pk_transaction_db_add_duration (db, PK_ROLE_ENUM_INSTALL_PACKAGES, "dummy", 1, 4000);
+	g_assert (ret);
+	value = pk_transaction_db_get_duration (db, PK_ROLE_ENUM_INSTALL_PACKAGES, "dummy", 1);
+	g_assert_cmpint (value, ==, 3000);
+
 	/* can we set the proxies */
 	ret = pk_transaction_db_set_proxy (db, 500, "session1", "127.0.0.1:80", "127.0.0.1:21");
 	g_assert (ret);
@@ -1834,6 +2036,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit/syslog", pk_test_dbus_func);
 	g_test_add_func ("/packagekit/conf", pk_test_conf_func);
 	g_test_add_func ("/packagekit/cache", pk_test_conf_func);
+	g_test_add_func ("/packagekit/file-index", pk_test_file_index_func);
 	g_test_add_func ("/packagekit/store", pk_test_store_func);
 	g_test_add_func ("/packagekit/inhibit", pk_test_inhibit_func);
 	g_test_add_func ("/packagekit/spawn", pk_test_spawn_func);
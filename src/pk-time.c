@@ -58,6 +58,7 @@ struct PkTimePrivate
 	guint			 average_max;
 	guint			 value_min;
 	guint			 value_max;
+	guint			 expected; /* ms */
 	GPtrArray		*array;
 	GTimer			*timer;
 };
@@ -103,6 +104,24 @@ pk_time_set_value_limits (PkTime *pktime, guint value_min, guint value_max)
 	return TRUE;
 }
 
+/**
+ * pk_time_set_expected:
+ * @pktime: This class instance
+ * @expected: how long the whole action took in the past, in ms, or 0 if unknown
+ *
+ * The expected duration is blended with the measured progress, so the
+ * estimate is stable from the start. It is kept over pk_time_reset().
+ *
+ * Return value: if we set the expected duration correctly
+ **/
+gboolean
+pk_time_set_expected (PkTime *pktime, guint expected)
+{
+	g_return_val_if_fail (PK_IS_TIME (pktime), FALSE);
+	pktime->priv->expected = expected;
+	return TRUE;
+}
+
 /**
  * pk_time_get_elapsed:
  *
@@ -150,6 +169,8 @@ pk_time_get_remaining (PkTime *pktime)
 	guint length;
 	gfloat grad;
 	gfloat grad_ave = 0.0f;
+	gfloat grad_expected = 0.0f;
+	gfloat weight;
 	gfloat estimated;
 	guint percentage_left;
 	guint elapsed;
@@ -158,14 +179,18 @@ pk_time_get_remaining (PkTime *pktime)
 
 	g_return_val_if_fail (PK_IS_TIME (pktime), 0);
 
+	/* what we have seen before */
+	if (pktime->priv->expected > 0)
+		grad_expected = 100.0f / (gfloat) pktime->priv->expected;
+
 	length = pktime->priv->array->len;
-	if (length < 2) {
+	if (length < 2 && grad_expected == 0.0f) {
 		g_debug ("array too small");
 		return 0;
 	}
 
-	/* get as many as we can */
-	for (i=length-1; i>0; i--) {
+	/* get as many as we can, there may be none if we only have history */
+	for (i=length-1; length >= 2 && i>0; i--) {
 		item_prev = g_ptr_array_index (pktime->priv->array, i-1);
 		item = g_ptr_array_index (pktime->priv->array, i);
 		grad = pk_time_get_gradient (item, item_prev);
@@ -183,12 +208,25 @@ pk_time_get_remaining (PkTime *pktime)
 
 	g_debug ("averaged %i points", averaged);
 	if (averaged < pktime->priv->average_min) {
-		g_debug ("not enough samples for accurate time: %i", averaged);
-		return 0;
+		if (grad_expected == 0.0f) {
+			g_debug ("not enough samples for accurate time: %i", averaged);
+			return 0;
+		}
+		/* trust the history until we have enough samples */
+		g_debug ("not enough samples, using expected time");
+		grad_ave = grad_expected;
+	} else {
+		/* normalise to the number of samples */
+		grad_ave /= averaged;
+
+		/* trust this transaction more as we get more samples */
+		if (grad_expected > 0.0f) {
+			weight = (gfloat) averaged / (gfloat) (pktime->priv->average_max + 1);
+			if (weight > 1.0f)
+				weight = 1.0f;
+			grad_ave = weight * grad_ave + (1.0f - weight) * grad_expected;
+		}
 	}
-
-	/* normalise to the number of samples */
-	grad_ave /= averaged;
 	g_debug ("grad_ave=%f", grad_ave);
 
 	/* just for debugging */
@@ -196,8 +234,7 @@ pk_time_get_remaining (PkTime *pktime)
 	g_debug ("elapsed=%i", elapsed);
 
 	/* 100 percent to be complete */
-	item = g_ptr_array_index (pktime->priv->array, length - 1);
-	percentage_left = 100 - item->percentage;
+	percentage_left = 100 - pktime->priv->last_percentage;
 	g_debug ("percentage_left=%i", percentage_left);
 	estimated = (gfloat) percentage_left / grad_ave;
 
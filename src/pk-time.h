@@ -64,6 +64,8 @@ gboolean	 pk_time_set_average_limits		(PkTime		*pktime,
 gboolean	 pk_time_set_value_limits		(PkTime		*pktime,
 							 guint		 value_min,
 							 guint		 value_max);
+gboolean	 pk_time_set_expected			(PkTime		*pktime,
+							 guint		 expected);
 
 G_END_DECLS
 
@@ -48,6 +48,7 @@ static void     pk_transaction_db_finalize	(GObject        *object);
 #define PK_TRANSACTION_DB_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION_DB, PkTransactionDbPrivate))
 
 #define PK_TRANSACTION_DB_ID_FILE_OBSOLETE	LOCALSTATEDIR "/lib/PackageKit/job_count.dat"
+#define PK_TRANSACTION_DB_DURATION_SAMPLES	10 /* transactions averaged over */
 
 struct PkTransactionDbPrivate
 {
@@ -71,6 +72,11 @@ typedef struct {
 	gboolean	set;
 } PkTransactionDbProxyItem;
 
+typedef struct {
+	guint		item_duration;
+	guint		samples;
+} PkTransactionDbDurationItem;
+
 /**
  * pk_transaction_sqlite_transaction_cb:
  **/
@@ -431,6 +437,119 @@ pk_transaction_db_set_finished (PkTransactionDb *tdb, const gchar *tid, gboolean
 	return TRUE;
 }
 
+/**
+ * pk_transaction_sqlite_duration_cb:
+ **/
+static gint
+pk_transaction_sqlite_duration_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+{
+	PkTransactionDbDurationItem *item = (PkTransactionDbDurationItem *) data;
+	gint i;
+	gchar *col;
+	gchar *value;
+	gboolean ret;
+
+	for (i=0; i<argc; i++) {
+		col = col_name[i];
+		value = argv[i];
+		if (g_strcmp0 (col, "item_duration") == 0) {
+			ret = egg_strtouint (value, &item->item_duration);
+			if (!ret)
+				g_warning ("failed to parse item_duration: %s", value);
+		} else if (g_strcmp0 (col, "samples") == 0) {
+			ret = egg_strtouint (value, &item->samples);
+			if (!ret)
+				g_warning ("failed to parse samples: %s", value);
+		} else {
+			g_warning ("%s = %s\n", col, value);
+		}
+	}
+	return 0;
+}
+
+/**
+ * pk_transaction_db_get_duration_item:
+ **/
+static gboolean
+pk_transaction_db_get_duration_item (PkTransactionDb *tdb, PkRoleEnum role, const gchar *backend,
+				     PkTransactionDbDurationItem *item)
+{
+	gchar *error_msg = NULL;
+	gchar *statement;
+	gint rc;
+
+	item->item_duration = 0;
+	item->samples = 0;
+	statement = g_strdup_printf ("SELECT item_duration, samples FROM durations WHERE role = '%s' AND backend = '%s'",
+				     pk_role_enum_to_string (role), backend);
+	rc = sqlite3_exec (tdb->priv->db, statement, pk_transaction_sqlite_duration_cb, item, &error_msg);
+	g_free (statement);
+	if (rc != SQLITE_OK) {
+		g_warning ("SQL error: %s\n", error_msg);
+		sqlite3_free (error_msg);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * pk_transaction_db_get_duration:
+ * @role: the role of the transaction
+ * @backend: the name of the backend that will run it
+ * @items: the number of packages the transaction is for, or 1
+ *
+ * Return value: how long a transaction like this took before in ms, or 0 if unknown
+ **/
+guint
+pk_transaction_db_get_duration (PkTransactionDb *tdb, PkRoleEnum role, const gchar *backend, guint items)
+{
+	PkTransactionDbDurationItem item;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), 0);
+	g_return_val_if_fail (backend != NULL, 0);
+
+	if (!pk_transaction_db_get_duration_item (tdb, role, backend, &item))
+		return 0;
+	return item.item_duration * MAX (items, 1);
+}
+
+/**
+ * pk_transaction_db_add_duration:
+ * @role: the role of the transaction
+ * @backend: the name of the backend that ran it
+ * @items: the number of packages the transaction was for, or 1
+ * @runtime: how long it took in ms
+ *
+ * Adds a successful transaction to the time per package kept for the role
+ * and backend, which is averaged over the last few transactions.
+ **/
+gboolean
+pk_transaction_db_add_duration (PkTransactionDb *tdb, PkRoleEnum role, const gchar *backend, guint items, guint runtime)
+{
+	PkTransactionDbDurationItem item;
+	gchar *statement;
+	guint item_duration;
+	guint samples;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (backend != NULL, FALSE);
+
+	if (!pk_transaction_db_get_duration_item (tdb, role, backend, &item))
+		return FALSE;
+
+	/* a moving average, so we follow changes in mirrors and hardware */
+	item_duration = runtime / MAX (items, 1);
+	samples = MIN (item.samples, PK_TRANSACTION_DB_DURATION_SAMPLES - 1);
+	item_duration = (item.item_duration * samples + item_duration) / (samples + 1);
+
+	statement = g_strdup_printf ("INSERT OR REPLACE INTO durations (role, backend, item_duration, samples) "
+				     "VALUES ('%s', '%s', %i, %i)",
+				     pk_role_enum_to_string (role), backend, item_duration, samples + 1);
+	pk_transaction_db_sql_statement (tdb, statement);
+	g_free (statement);
+	return TRUE;
+}
+
 /**
  * pk_transaction_db_print:
  **/
@@ -837,6 +956,16 @@ pk_transaction_db_init (PkTransactionDb *tdb)
 		sqlite3_exec (tdb->priv->db, statement, NULL, NULL, NULL);
 	}
 
+	/* check durations (since 0.6.11) */
+	rc = sqlite3_exec (tdb->priv->db, "SELECT * FROM durations LIMIT 1", NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_debug ("adding durations: %s", error_msg);
+		sqlite3_free (error_msg);
+		statement = "CREATE TABLE durations (role TEXT, backend TEXT, item_duration INTEGER, samples INTEGER, "
+			    "PRIMARY KEY (role, backend));";
+		sqlite3_exec (tdb->priv->db, statement, NULL, NULL, NULL);
+	}
+
 	/* check config (since 0.4.6) */
 	rc = sqlite3_exec (tdb->priv->db, "SELECT * FROM config LIMIT 1", NULL, NULL, &error_msg);
 	if (rc != SQLITE_OK) {
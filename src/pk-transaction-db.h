@@ -81,6 +81,15 @@ gboolean	 pk_transaction_db_action_time_reset	(PkTransactionDb	*tdb,
 							 PkRoleEnum		 role);
 guint		 pk_transaction_db_action_time_since	(PkTransactionDb	*tdb,
 							 PkRoleEnum		 role);
+guint		 pk_transaction_db_get_duration		(PkTransactionDb	*tdb,
+							 PkRoleEnum		 role,
+							 const gchar		*backend,
+							 guint			 items);
+gboolean	 pk_transaction_db_add_duration		(PkTransactionDb	*tdb,
+							 PkRoleEnum		 role,
+							 const gchar		*backend,
+							 guint			 items,
+							 guint			 runtime);
 gchar		*pk_transaction_db_generate_id		(PkTransactionDb	*tdb)
 							 G_GNUC_WARN_UNUSED_RESULT;
 gboolean	 pk_transaction_db_get_proxy		(PkTransactionDb	*tdb,
@@ -26,13 +26,16 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-desktop.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-command-index.h>
 #include <gio/gdesktopappinfo.h>
 #include <sqlite3.h>
 
@@ -43,6 +46,9 @@
 #include "pk-lsof.h"
 #include "pk-proc.h"
 #include "pk-conf.h"
+#include "pk-file-index.h"
+
+#define PK_TRANSACTION_EXTRA_PACKAGE_LIST_CHECKSUM	PK_SYSTEM_PACKAGE_LIST_FILENAME ".sha1"
 
 #define PK_POST_TRANS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_POST_TRANS, PkTransactionExtraPrivate))
 
@@ -55,10 +61,12 @@ struct PkTransactionExtraPrivate
 	PkLsof			*lsof;
 	PkProc			*proc;
 	PkConf			*conf;
+	PkFileIndex		*file_index;
 	guint			 finished_id;
 	guint			 package_id;
 	gchar			**no_update_process_list;
 	GHashTable		*hash;
+	GHashTable		*commands;
 	GPtrArray		*files_list;
 	GPtrArray		*pids;
 };
@@ -118,13 +126,147 @@ pk_transaction_extra_set_progress_changed (PkTransactionExtra *extra, guint perc
 }
 
 /**
- * pk_transaction_extra_get_installed_package_for_file:
+ * pk_transaction_extra_package_id_to_installed:
+ *
+ * The file index is keyed on 'installed' package_ids, so we can use the
+ * local package database for GetFiles rather than remote metadata.
+ **/
+static gchar *
+pk_transaction_extra_package_id_to_installed (const gchar *package_id)
+{
+	gchar **split;
+	gchar *package_id_tmp;
+
+	split = pk_package_id_split (package_id);
+	if (split == NULL)
+		return NULL;
+	package_id_tmp = pk_package_id_build (split[PK_PACKAGE_ID_NAME],
+					      split[PK_PACKAGE_ID_VERSION],
+					      split[PK_PACKAGE_ID_ARCH],
+					      "installed");
+	g_strfreev (split);
+	return package_id_tmp;
+}
+
+/**
+ * pk_transaction_extra_files_index_cb:
+ **/
+static void
+pk_transaction_extra_files_index_cb (PkBackend *backend, PkFiles *files, PkTransactionExtra *extra)
+{
+	gchar **filenames = NULL;
+	gchar *package_id = NULL;
+	gchar *package_id_tmp;
+
+	/* get data */
+	g_object_get (files,
+		      "package-id", &package_id,
+		      "files", &filenames,
+		      NULL);
+
+	package_id_tmp = pk_transaction_extra_package_id_to_installed (package_id);
+	if (package_id_tmp != NULL && filenames != NULL)
+		pk_file_index_add_files (extra->priv->file_index, package_id_tmp, filenames);
+	g_free (package_id_tmp);
+	g_strfreev (filenames);
+	g_free (package_id);
+}
+
+/**
+ * pk_transaction_extra_file_index_add_packages:
+ **/
+static void
+pk_transaction_extra_file_index_add_packages (PkTransactionExtra *extra, gchar **package_ids)
+{
+	guint signal_files;
+
+	signal_files = g_signal_connect (extra->priv->backend, "files",
+					 G_CALLBACK (pk_transaction_extra_files_index_cb), extra);
+
+	pk_backend_reset (extra->priv->backend);
+	pk_backend_get_files (extra->priv->backend, package_ids);
+
+	/* wait for finished */
+	g_main_loop_run (extra->priv->loop);
+
+	g_signal_handler_disconnect (extra->priv->backend, signal_files);
+}
+
+/**
+ * pk_transaction_extra_ensure_file_index:
+ *
+ * Populates the file index from the backend the first time it is needed,
+ * using one GetPackages and one GetFiles rather than a SearchFile for
+ * every filename we ever need to resolve.
+ *
+ * Return value: %TRUE if the file index can be used
  **/
-static PkPackage *
-pk_transaction_extra_get_installed_package_for_file (PkTransactionExtra *extra, const gchar *filename)
+static gboolean
+pk_transaction_extra_ensure_file_index (PkTransactionExtra *extra)
 {
-	PkPackage *package = NULL;
+	GPtrArray *list;
+	PkPackage *package;
+	gchar **package_ids;
+	guint i;
+
+	/* already done */
+	if (pk_file_index_get_populated (extra->priv->file_index))
+		return TRUE;
+
+	/* no support */
+	if (!pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_GET_PACKAGES) ||
+	    !pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_GET_FILES)) {
+		g_debug ("cannot build file index");
+		return FALSE;
+	}
+
+	/* get all the installed packages */
+	if (extra->priv->list->len > 0)
+		g_ptr_array_remove_range (extra->priv->list, 0, extra->priv->list->len);
+	pk_backend_reset (extra->priv->backend);
+	pk_backend_get_packages (extra->priv->backend, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED));
+
+	/* wait for finished */
+	g_main_loop_run (extra->priv->loop);
+
+	if (extra->priv->list->len == 0) {
+		g_warning ("no installed packages, not building file index");
+		return FALSE;
+	}
+
+	/* get the file lists of all of them in one go */
+	list = g_ptr_array_new_with_free_func (g_free);
+	for (i=0; i<extra->priv->list->len; i++) {
+		package = g_ptr_array_index (extra->priv->list, i);
+		g_ptr_array_add (list, g_strdup (pk_package_get_id (package)));
+	}
+	package_ids = pk_ptr_array_to_strv (list);
+	pk_transaction_extra_file_index_add_packages (extra, package_ids);
+	g_debug ("indexed the files of %i installed packages", list->len);
+	pk_file_index_set_populated (extra->priv->file_index, TRUE);
+
+	g_strfreev (package_ids);
+	g_ptr_array_unref (list);
+	return TRUE;
+}
+
+/**
+ * pk_transaction_extra_search_installed_package_for_file:
+ *
+ * Only used when the backend cannot give us a file index.
+ **/
+static gchar *
+pk_transaction_extra_search_installed_package_for_file (PkTransactionExtra *extra, const gchar *filename)
+{
+	PkPackage *package;
 	gchar **filenames;
+	gchar *package_id = NULL;
+
+	/* no support */
+	if (!pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_SEARCH_FILE)) {
+		g_debug ("cannot search files");
+		goto out;
+	}
 
 	/* use PK to find the correct package */
 	if (extra->priv->list->len > 0)
@@ -149,8 +291,89 @@ pk_transaction_extra_get_installed_package_for_file (PkTransactionExtra *extra,
 		g_warning ("cannot get package");
 		goto out;
 	}
+	package_id = g_strdup (pk_package_get_id (package));
 out:
-	return package;
+	return package_id;
+}
+
+/**
+ * pk_transaction_extra_get_installed_package_ids_for_files:
+ *
+ * Return value: an array of package_ids, or %NULL where the file is not
+ * owned by any installed package, in the same order as @filenames.
+ **/
+static GPtrArray *
+pk_transaction_extra_get_installed_package_ids_for_files (PkTransactionExtra *extra, gchar **filenames)
+{
+	GPtrArray *array;
+	guint i;
+
+	/* resolve them all from the index */
+	if (pk_transaction_extra_ensure_file_index (extra))
+		return pk_file_index_resolve (extra->priv->file_index, filenames);
+
+	/* fall back to one search per file */
+	array = g_ptr_array_new_with_free_func (g_free);
+	for (i=0; filenames[i] != NULL; i++)
+		g_ptr_array_add (array, pk_transaction_extra_search_installed_package_for_file (extra, filenames[i]));
+	return array;
+}
+
+/**
+ * pk_transaction_extra_update_file_index:
+ * @packages: the #PkPackage's emitted by the finished transaction
+ *
+ * Keeps the file index in sync without having to rebuild it.
+ **/
+gboolean
+pk_transaction_extra_update_file_index (PkTransactionExtra *extra, GPtrArray *packages)
+{
+	guint i;
+	PkInfoEnum info;
+	PkPackage *package;
+	GPtrArray *list;
+	gchar **package_ids;
+	gchar *package_id;
+
+	g_return_val_if_fail (PK_IS_POST_TRANS (extra), FALSE);
+	g_return_val_if_fail (packages != NULL, FALSE);
+
+	/* nothing to keep up to date */
+	if (!pk_file_index_get_populated (extra->priv->file_index))
+		return FALSE;
+
+	list = g_ptr_array_new_with_free_func (g_free);
+	for (i=0; i<packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		info = pk_package_get_info (package);
+		package_id = pk_transaction_extra_package_id_to_installed (pk_package_get_id (package));
+		if (package_id == NULL)
+			continue;
+		if (info == PK_INFO_ENUM_REMOVING || info == PK_INFO_ENUM_OBSOLETING) {
+			pk_file_index_remove_package (extra->priv->file_index, package_id);
+			g_free (package_id);
+		} else if (info == PK_INFO_ENUM_UPDATING) {
+			pk_file_index_remove_older (extra->priv->file_index, package_id);
+			g_ptr_array_add (list, package_id);
+		} else if (info == PK_INFO_ENUM_INSTALLING) {
+			g_ptr_array_add (list, package_id);
+		} else {
+			g_free (package_id);
+		}
+	}
+
+	/* add the new file lists in one go */
+	if (list->len > 0) {
+		if (pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_GET_FILES)) {
+			package_ids = pk_ptr_array_to_strv (list);
+			pk_transaction_extra_file_index_add_packages (extra, package_ids);
+			g_strfreev (package_ids);
+		} else {
+			pk_file_index_invalidate (extra->priv->file_index);
+		}
+	}
+	g_ptr_array_unref (list);
+	return TRUE;
 }
 
 /**
@@ -186,18 +409,125 @@ out:
 }
 
 /**
- * pk_transaction_extra_sqlite_remove_filename:
+ * PkTransactionExtraDesktopItem:
+ *
+ * A row in the desktop file cache. We keep the inode, size and mtime so
+ * that a rescan only has to hash the files that have actually changed.
  **/
-static gint
-pk_transaction_extra_sqlite_remove_filename (PkTransactionExtra *extra, const gchar *filename)
+typedef struct {
+	gchar			*filename;
+	gchar			*package;
+	gchar			*md5;
+	gchar			*md5_old;
+	guint64			 inode;
+	guint64			 size;
+	guint64			 mtime;
+	gint			 show;
+	gboolean		 found;
+} PkTransactionExtraDesktopItem;
+
+/**
+ * pk_transaction_extra_desktop_item_new:
+ **/
+static PkTransactionExtraDesktopItem *
+pk_transaction_extra_desktop_item_new (const gchar *filename)
 {
-	gchar *statement;
-	gint rc;
+	PkTransactionExtraDesktopItem *item;
+	item = g_new0 (PkTransactionExtraDesktopItem, 1);
+	item->filename = g_strdup (filename);
+	item->show = -1;
+	return item;
+}
 
-	statement = g_strdup_printf ("DELETE FROM cache WHERE filename = '%s'", filename);
-	rc = sqlite3_exec (extra->priv->db, statement, NULL, NULL, NULL);
-	g_free (statement);
-	return rc;
+/**
+ * pk_transaction_extra_desktop_item_free:
+ **/
+static void
+pk_transaction_extra_desktop_item_free (PkTransactionExtraDesktopItem *item)
+{
+	g_free (item->filename);
+	g_free (item->package);
+	g_free (item->md5);
+	g_free (item->md5_old);
+	g_free (item);
+}
+
+/**
+ * pk_transaction_extra_desktop_item_refresh_stat:
+ *
+ * Return value: %TRUE if the file has changed since we last saw it
+ **/
+static gboolean
+pk_transaction_extra_desktop_item_refresh_stat (PkTransactionExtraDesktopItem *item)
+{
+	struct stat buf;
+	gboolean changed;
+
+	if (g_stat (item->filename, &buf) != 0)
+		return TRUE;
+
+	changed = (item->inode != (guint64) buf.st_ino ||
+		   item->size != (guint64) buf.st_size ||
+		   item->mtime != (guint64) buf.st_mtime);
+	item->inode = buf.st_ino;
+	item->size = buf.st_size;
+	item->mtime = buf.st_mtime;
+	return changed;
+}
+
+/**
+ * pk_transaction_extra_desktop_item_process_cb:
+ *
+ * Called in a worker thread, so must not touch the database or the backend.
+ **/
+static void
+pk_transaction_extra_desktop_item_process_cb (PkTransactionExtraDesktopItem *item, gpointer user_data)
+{
+	GDesktopAppInfo *info;
+
+	item->md5 = pk_transaction_extra_get_filename_md5 (item->filename);
+	if (item->md5 == NULL)
+		return;
+
+	/* only the metadata changed, so we can keep the old data */
+	if (g_strcmp0 (item->md5, item->md5_old) == 0)
+		return;
+
+	/* find out if we should show desktop file in menus */
+	info = g_desktop_app_info_new_from_filename (item->filename);
+	if (info == NULL) {
+		g_warning ("could not load desktop file %s", item->filename);
+		item->show = -1;
+		return;
+	}
+	item->show = g_app_info_should_show (G_APP_INFO (info));
+	g_object_unref (info);
+}
+
+/**
+ * pk_transaction_extra_process_desktop_items:
+ *
+ * Hash and parse the changed desktop files using all the processors.
+ **/
+static void
+pk_transaction_extra_process_desktop_items (GPtrArray *items)
+{
+	GThreadPool *pool;
+	glong threads;
+	guint i;
+
+	threads = sysconf (_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+
+	/* a shared pool never fails to be created */
+	pool = g_thread_pool_new ((GFunc) pk_transaction_extra_desktop_item_process_cb,
+				  NULL, (gint) threads, FALSE, NULL);
+	for (i=0; i<items->len; i++)
+		g_thread_pool_push (pool, g_ptr_array_index (items, i), NULL);
+
+	/* wait for all the items to be processed */
+	g_thread_pool_free (pool, FALSE, TRUE);
 }
 
 /**
@@ -206,12 +536,11 @@ pk_transaction_extra_sqlite_remove_filename (PkTransactionExtra *extra, const gc
 static gint
 pk_transaction_extra_sqlite_add_filename_details (PkTransactionExtra *extra, const gchar *filename, const gchar *package, const gchar *md5)
 {
-	gchar *statement;
-	gchar *error_msg = NULL;
 	sqlite3_stmt *sql_statement = NULL;
 	gint rc = -1;
 	gint show;
 	GDesktopAppInfo *info;
+	struct stat buf;
 
 	/* find out if we should show desktop file in menus */
 	info = g_desktop_app_info_new_from_filename (filename);
@@ -222,15 +551,25 @@ pk_transaction_extra_sqlite_add_filename_details (PkTransactionExtra *extra, con
 	show = g_app_info_should_show (G_APP_INFO (info));
 	g_object_unref (info);
 
+	/* so the next rescan does not have to hash this again */
+	if (g_stat (filename, &buf) != 0)
+		memset (&buf, 0, sizeof (buf));
+
 	g_debug ("add filename %s from %s with md5: %s (show: %i)", filename, package, md5, show);
 
 	/* the row might already exist */
-	statement = g_strdup_printf ("DELETE FROM cache WHERE filename = '%s'", filename);
-	sqlite3_exec (extra->priv->db, statement, NULL, NULL, NULL);
-	g_free (statement);
+	rc = sqlite3_prepare_v2 (extra->priv->db, "DELETE FROM cache WHERE filename = ?", -1, &sql_statement, NULL);
+	if (rc != SQLITE_OK) {
+		g_warning ("SQL failed to prepare: %s", sqlite3_errmsg (extra->priv->db));
+		goto out;
+	}
+	sqlite3_bind_text (sql_statement, 1, filename, -1, SQLITE_STATIC);
+	sqlite3_step (sql_statement);
+	sqlite3_finalize (sql_statement);
 
 	/* prepare the query, as we don't escape it */
-	rc = sqlite3_prepare_v2 (extra->priv->db, "INSERT INTO cache (filename, package, show, md5) VALUES (?, ?, ?, ?)", -1, &sql_statement, NULL);
+	rc = sqlite3_prepare_v2 (extra->priv->db, "INSERT INTO cache (filename, package, show, md5, inode, size, mtime) "
+				 "VALUES (?, ?, ?, ?, ?, ?, ?)", -1, &sql_statement, NULL);
 	if (rc != SQLITE_OK) {
 		g_warning ("SQL failed to prepare: %s", sqlite3_errmsg (extra->priv->db));
 		goto out;
@@ -241,51 +580,111 @@ pk_transaction_extra_sqlite_add_filename_details (PkTransactionExtra *extra, con
 	sqlite3_bind_text (sql_statement, 2, package, -1, SQLITE_STATIC);
 	sqlite3_bind_int (sql_statement, 3, show);
 	sqlite3_bind_text (sql_statement, 4, md5, -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (sql_statement, 5, (sqlite3_int64) buf.st_ino);
+	sqlite3_bind_int64 (sql_statement, 6, (sqlite3_int64) buf.st_size);
+	sqlite3_bind_int64 (sql_statement, 7, (sqlite3_int64) buf.st_mtime);
 
 	/* save this */
 	sqlite3_step (sql_statement);
 	rc = sqlite3_finalize (sql_statement);
 	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s\n", error_msg);
-		sqlite3_free (error_msg);
+		g_warning ("SQL error: %s", sqlite3_errmsg (extra->priv->db));
 		goto out;
 	}
-
 out:
 	return rc;
 }
 
 /**
- * pk_transaction_extra_sqlite_add_filename:
+ * pk_transaction_extra_sqlite_save_desktop_items:
+ *
+ * Writes all the changes of one scan in a single database transaction.
  **/
-static gint
-pk_transaction_extra_sqlite_add_filename (PkTransactionExtra *extra, const gchar *filename, const gchar *md5_opt)
+static gboolean
+pk_transaction_extra_sqlite_save_desktop_items (PkTransactionExtra *extra, GPtrArray *changed)
 {
-	gchar *md5 = NULL;
-	gint rc = -1;
-	PkPackage *package;
-	gchar **parts = NULL;
+	gboolean ret = FALSE;
+	gint rc;
+	guint i;
+	gfloat step;
+	gchar *error_msg = NULL;
+	GHashTableIter iter;
+	PkTransactionExtraDesktopItem *item;
+	sqlite3_stmt *statement_delete = NULL;
+	sqlite3_stmt *statement_insert = NULL;
 
-	/* if we've got it, use old data */
-	if (md5_opt != NULL)
-		md5 = g_strdup (md5_opt);
-	else
-		md5 = pk_transaction_extra_get_filename_md5 (filename);
+	rc = sqlite3_exec (extra->priv->db, "BEGIN TRANSACTION", NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_warning ("SQL error: %s", error_msg);
+		sqlite3_free (error_msg);
+		goto out;
+	}
 
-	/* resolve */
-	package = pk_transaction_extra_get_installed_package_for_file (extra, filename);
-	if (package == NULL) {
-		g_warning ("failed to get list");
+	rc = sqlite3_prepare_v2 (extra->priv->db, "DELETE FROM cache WHERE filename = ?", -1, &statement_delete, NULL);
+	if (rc != SQLITE_OK) {
+		g_warning ("SQL failed to prepare: %s", sqlite3_errmsg (extra->priv->db));
+		goto out;
+	}
+	rc = sqlite3_prepare_v2 (extra->priv->db, "INSERT INTO cache (filename, package, show, md5, inode, size, mtime) "
+				 "VALUES (?, ?, ?, ?, ?, ?, ?)", -1, &statement_insert, NULL);
+	if (rc != SQLITE_OK) {
+		g_warning ("SQL failed to prepare: %s", sqlite3_errmsg (extra->priv->db));
 		goto out;
 	}
 
-	/* add */
-	parts = pk_package_id_split (pk_package_get_id (package));
-	rc = pk_transaction_extra_sqlite_add_filename_details (extra, filename, parts[PK_PACKAGE_ID_NAME], md5);
+	/* remove the files that no longer exist */
+	g_hash_table_iter_init (&iter, extra->priv->hash);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &item)) {
+		if (item->found)
+			continue;
+		g_debug ("remove of %s as no longer found", item->filename);
+		sqlite3_bind_text (statement_delete, 1, item->filename, -1, SQLITE_STATIC);
+		sqlite3_step (statement_delete);
+		sqlite3_reset (statement_delete);
+	}
+
+	/* replace the new and modified files */
+	step = changed->len > 0 ? 100.0f / changed->len : 0.0f;
+	for (i=0; i<changed->len; i++) {
+		item = g_ptr_array_index (changed, i);
+		pk_transaction_extra_set_progress_changed (extra, i * step);
+
+		sqlite3_bind_text (statement_delete, 1, item->filename, -1, SQLITE_STATIC);
+		sqlite3_step (statement_delete);
+		sqlite3_reset (statement_delete);
+
+		/* not valid, or not owned by any package */
+		if (item->md5 == NULL || item->show < 0 || item->package == NULL)
+			continue;
+
+		g_debug ("add filename %s from %s with md5: %s (show: %i)",
+			 item->filename, item->package, item->md5, item->show);
+		sqlite3_bind_text (statement_insert, 1, item->filename, -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement_insert, 2, item->package, -1, SQLITE_STATIC);
+		sqlite3_bind_int (statement_insert, 3, item->show);
+		sqlite3_bind_text (statement_insert, 4, item->md5, -1, SQLITE_STATIC);
+		sqlite3_bind_int64 (statement_insert, 5, (sqlite3_int64) item->inode);
+		sqlite3_bind_int64 (statement_insert, 6, (sqlite3_int64) item->size);
+		sqlite3_bind_int64 (statement_insert, 7, (sqlite3_int64) item->mtime);
+		sqlite3_step (statement_insert);
+		sqlite3_reset (statement_insert);
+	}
+
+	rc = sqlite3_exec (extra->priv->db, "COMMIT", NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_warning ("SQL error: %s", error_msg);
+		sqlite3_free (error_msg);
+		goto out;
+	}
+	ret = TRUE;
 out:
-	g_strfreev (parts);
-	g_free (md5);
-	return rc;
+	if (statement_delete != NULL)
+		sqlite3_finalize (statement_delete);
+	if (statement_insert != NULL)
+		sqlite3_finalize (statement_insert);
+	if (!ret)
+		sqlite3_exec (extra->priv->db, "ROLLBACK", NULL, NULL, NULL);
+	return ret;
 }
 
 /**
@@ -295,50 +694,46 @@ static gint
 pk_transaction_extra_sqlite_cache_rescan_cb (void *data, gint argc, gchar **argv, gchar **col_name)
 {
 	PkTransactionExtra *extra = PK_POST_TRANS (data);
-	const gchar *filename = NULL;
-	const gchar *md5 = NULL;
-	gchar *md5_calc = NULL;
+	PkTransactionExtraDesktopItem *item = NULL;
 	gint i;
 
-	/* add the filename data to the array */
+	/* add the filename data to the hash */
 	for (i=0; i<argc; i++) {
 		if (g_strcmp0 (col_name[i], "filename") == 0 && argv[i] != NULL)
-			filename = argv[i];
-		else if (g_strcmp0 (col_name[i], "md5") == 0 && argv[i] != NULL)
-			md5 = argv[i];
+			item = pk_transaction_extra_desktop_item_new (argv[i]);
 	}
 
 	/* sanity check */
-	if (filename == NULL || md5 == NULL) {
-		g_warning ("filename %s and md5 %s)", filename, md5);
+	if (item == NULL) {
+		g_warning ("no filename in row");
 		goto out;
 	}
 
-	/* get md5 */
-	md5_calc = pk_transaction_extra_get_filename_md5 (filename);
-	if (md5_calc == NULL) {
-		g_debug ("remove of %s as no longer found", filename);
-		pk_transaction_extra_sqlite_remove_filename (extra, filename);
-		goto out;
-	}
-
-	/* we've checked the file */
-	g_hash_table_insert (extra->priv->hash, g_strdup (filename), GUINT_TO_POINTER (1));
-
-	/* check md5 is same */
-	if (g_strcmp0 (md5, md5_calc) != 0) {
-		g_debug ("add of %s as md5 invalid (%s vs %s)", filename, md5, md5_calc);
-		pk_transaction_extra_sqlite_add_filename (extra, filename, md5_calc);
+	for (i=0; i<argc; i++) {
+		if (argv[i] == NULL)
+			continue;
+		if (g_strcmp0 (col_name[i], "package") == 0)
+			item->package = g_strdup (argv[i]);
+		else if (g_strcmp0 (col_name[i], "md5") == 0)
+			item->md5_old = g_strdup (argv[i]);
+		else if (g_strcmp0 (col_name[i], "show") == 0)
+			item->show = atoi (argv[i]);
+		else if (g_strcmp0 (col_name[i], "inode") == 0)
+			item->inode = g_ascii_strtoull (argv[i], NULL, 10);
+		else if (g_strcmp0 (col_name[i], "size") == 0)
+			item->size = g_ascii_strtoull (argv[i], NULL, 10);
+		else if (g_strcmp0 (col_name[i], "mtime") == 0)
+			item->mtime = g_ascii_strtoull (argv[i], NULL, 10);
 	}
-
-	g_debug ("existing filename %s valid, md5=%s", filename, md5);
+	g_hash_table_insert (extra->priv->hash, g_strdup (item->filename), item);
 out:
-	g_free (md5_calc);
 	return 0;
 }
 
 /**
  * pk_transaction_extra_get_desktop_files:
+ *
+ * Adds the new and modified desktop files to @array.
  **/
 static void
 pk_transaction_extra_get_desktop_files (PkTransactionExtra *extra,
@@ -348,7 +743,7 @@ pk_transaction_extra_get_desktop_files (PkTransactionExtra *extra,
 	GError *error = NULL;
 	GDir *dir;
 	const gchar *filename;
-	gpointer data;
+	PkTransactionExtraDesktopItem *item;
 	gchar *path;
 
 	/* open directory */
@@ -366,11 +761,17 @@ pk_transaction_extra_get_desktop_files (PkTransactionExtra *extra,
 		if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
 			pk_transaction_extra_get_desktop_files (extra, path, array);
 		} else if (g_str_has_suffix (filename, ".desktop")) {
-			data = g_hash_table_lookup (extra->priv->hash, path);
-			if (data == NULL) {
+			item = g_hash_table_lookup (extra->priv->hash, path);
+			if (item == NULL) {
 				g_debug ("add of %s as not present in db", path);
-				g_ptr_array_add (array, g_strdup (path));
+				item = pk_transaction_extra_desktop_item_new (path);
+				g_hash_table_insert (extra->priv->hash, g_strdup (path), item);
 			}
+			item->found = TRUE;
+
+			/* only look inside the file if it has been touched */
+			if (pk_transaction_extra_desktop_item_refresh_stat (item))
+				g_ptr_array_add (array, item);
 		}
 		g_free (path);
 		filename = g_dir_read_name (dir);
@@ -384,12 +785,15 @@ pk_transaction_extra_get_desktop_files (PkTransactionExtra *extra,
 gboolean
 pk_transaction_extra_import_desktop_files (PkTransactionExtra *extra)
 {
-	gchar *statement;
 	gchar *error_msg = NULL;
 	gint rc;
-	gchar *path;
-	GPtrArray *array;
-	gfloat step;
+	gchar **parts;
+	gchar **paths;
+	const gchar *package_id;
+	GPtrArray *changed;
+	GPtrArray *unresolved;
+	GPtrArray *package_ids;
+	PkTransactionExtraDesktopItem *item;
 	guint i;
 
 	g_return_val_if_fail (PK_IS_POST_TRANS (extra), FALSE);
@@ -401,7 +805,8 @@ pk_transaction_extra_import_desktop_files (PkTransactionExtra *extra)
 	}
 
 	/* no support */
-	if (!pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_SEARCH_FILE)) {
+	if (!pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_SEARCH_FILE) &&
+	    !pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_GET_FILES)) {
 		g_debug ("cannot search files");
 		return FALSE;
 	}
@@ -414,30 +819,66 @@ pk_transaction_extra_import_desktop_files (PkTransactionExtra *extra)
 	g_hash_table_remove_all (extra->priv->hash);
 	pk_transaction_extra_set_progress_changed (extra, 101);
 
-	/* first go through the existing data, and look for modifications and removals */
-	statement = g_strdup ("SELECT filename, md5 FROM cache");
-	rc = sqlite3_exec (extra->priv->db, statement, pk_transaction_extra_sqlite_cache_rescan_cb, extra, &error_msg);
-	g_free (statement);
+	/* first get what we knew about last time */
+	rc = sqlite3_exec (extra->priv->db, "SELECT filename, package, show, md5, inode, size, mtime FROM cache",
+			   pk_transaction_extra_sqlite_cache_rescan_cb, extra, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_warning ("SQL error: %s\n", error_msg);
 		sqlite3_free (error_msg);
 	}
 
-	array = g_ptr_array_new_with_free_func (g_free);
-	pk_transaction_extra_get_desktop_files (extra, PK_DESKTOP_DEFAULT_APPLICATION_DIR, array);
+	/* find the new and modified files */
+	changed = g_ptr_array_new ();
+	unresolved = g_ptr_array_new ();
+	pk_transaction_extra_get_desktop_files (extra, PK_DESKTOP_DEFAULT_APPLICATION_DIR, changed);
 
-	if (array->len) {
-		step = 100.0f / array->len;
-		pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+	/* hash and parse them in parallel */
+	if (changed->len > 0) {
+		g_debug ("processing %i new or modified desktop files", changed->len);
+		pk_transaction_extra_process_desktop_items (changed);
+	}
+
+	/* the owner may have changed if the contents did */
+	for (i=0; i<changed->len; i++) {
+		item = g_ptr_array_index (changed, i);
+		if (item->md5 == NULL || item->show < 0)
+			continue;
+		if (item->package == NULL || g_strcmp0 (item->md5, item->md5_old) != 0)
+			g_ptr_array_add (unresolved, item);
+	}
 
-		/* process files in an array */
-		for (i=0; i<array->len; i++) {
-			pk_transaction_extra_set_progress_changed (extra, i * step);
-			path = g_ptr_array_index (array, i);
-			pk_transaction_extra_sqlite_add_filename (extra, path, NULL);
+	/* resolve all the owners at once */
+	if (unresolved->len > 0) {
+		pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+		paths = g_new0 (gchar *, unresolved->len + 1);
+		for (i=0; i<unresolved->len; i++) {
+			item = g_ptr_array_index (unresolved, i);
+			paths[i] = item->filename;
+		}
+		package_ids = pk_transaction_extra_get_installed_package_ids_for_files (extra, paths);
+		for (i=0; i<unresolved->len; i++) {
+			item = g_ptr_array_index (unresolved, i);
+			package_id = g_ptr_array_index (package_ids, i);
+			g_free (item->package);
+			item->package = NULL;
+			if (package_id == NULL) {
+				g_debug ("failed to find package for %s", item->filename);
+				continue;
+			}
+			parts = pk_package_id_split (package_id);
+			item->package = g_strdup (parts[PK_PACKAGE_ID_NAME]);
+			g_strfreev (parts);
 		}
+		g_ptr_array_unref (package_ids);
+		g_free (paths);
 	}
-	g_ptr_array_free (array, TRUE);
+
+	/* write all the changes in one go */
+	pk_transaction_extra_sqlite_save_desktop_items (extra, changed);
+
+	g_ptr_array_unref (unresolved);
+	g_ptr_array_unref (changed);
+	g_hash_table_remove_all (extra->priv->hash);
 
 	pk_transaction_extra_set_progress_changed (extra, 100);
 	pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_FINISHED);
@@ -445,35 +886,231 @@ pk_transaction_extra_import_desktop_files (PkTransactionExtra *extra)
 }
 
 /**
- * pk_transaction_extra_package_list_to_string:
+ * PkTransactionExtraListItem:
+ *
+ * One line of the system package list.
+ **/
+typedef struct {
+	PkInfoEnum		 info;
+	gchar			*package_id;
+	gchar			*summary;
+	gboolean		 removed;
+} PkTransactionExtraListItem;
+
+/**
+ * pk_transaction_extra_list_item_free:
  **/
-static gchar *
-pk_transaction_extra_package_list_to_string (GPtrArray *array)
+static void
+pk_transaction_extra_list_item_free (PkTransactionExtraListItem *item)
+{
+	g_free (item->package_id);
+	g_free (item->summary);
+	g_free (item);
+}
+
+/**
+ * pk_transaction_extra_list_item_sort_cb:
+ **/
+static gint
+pk_transaction_extra_list_item_sort_cb (PkTransactionExtraListItem **a, PkTransactionExtraListItem **b)
+{
+	return g_strcmp0 ((*a)->package_id, (*b)->package_id);
+}
+
+/**
+ * pk_transaction_extra_package_list_save:
+ *
+ * Saves the items sorted by package_id, so readers can bisect the file,
+ * and stores the checksum so we know we can patch it next time.
+ **/
+static gboolean
+pk_transaction_extra_package_list_save (GPtrArray *items, GError **error)
 {
 	guint i;
-	PkPackage *package;
+	gboolean ret;
+	gchar *checksum = NULL;
 	GString *string;
-	PkInfoEnum info;
-	gchar *package_id;
-	gchar *summary;
+	PkTransactionExtraListItem *item;
+
+	g_ptr_array_sort (items, (GCompareFunc) pk_transaction_extra_list_item_sort_cb);
 
 	string = g_string_new ("");
-	for (i=0; i<array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		g_object_get (package,
-			      "info", &info,
-			      "package-id", &package_id,
-			      "summary", &summary,
-			      NULL);
-		g_string_append_printf (string, "%s\t%s\t%s\n", pk_info_enum_to_string (info), package_id, summary);
-		g_free (package_id);
-		g_free (summary);
+	for (i=0; i<items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		if (item->removed)
+			continue;
+		g_string_append_printf (string, "%s\t%s\t%s\n",
+					pk_info_enum_to_string (item->info),
+					item->package_id,
+					item->summary != NULL ? item->summary : "");
 	}
 
 	/* remove trailing newline */
 	if (string->len != 0)
 		g_string_set_size (string, string->len-1);
-	return g_string_free (string, FALSE);
+
+	ret = g_file_set_contents (PK_SYSTEM_PACKAGE_LIST_FILENAME, string->str, string->len, error);
+	if (!ret)
+		goto out;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, string->str, string->len);
+	ret = g_file_set_contents (PK_TRANSACTION_EXTRA_PACKAGE_LIST_CHECKSUM, checksum, -1, error);
+out:
+	g_free (checksum);
+	g_string_free (string, TRUE);
+	return ret;
+}
+
+/**
+ * pk_transaction_extra_package_list_load:
+ *
+ * Return value: the items in the saved list, or %NULL if the list has been
+ * changed since we wrote it and cannot be patched.
+ **/
+static GPtrArray *
+pk_transaction_extra_package_list_load (void)
+{
+	gboolean ret;
+	guint i;
+	gsize length;
+	gchar *data = NULL;
+	gchar *checksum = NULL;
+	gchar *checksum_saved = NULL;
+	gchar **lines = NULL;
+	gchar **sections;
+	GPtrArray *items = NULL;
+	PkTransactionExtraListItem *item;
+
+	/* get the saved checksum */
+	ret = g_file_get_contents (PK_TRANSACTION_EXTRA_PACKAGE_LIST_CHECKSUM, &checksum_saved, NULL, NULL);
+	if (!ret) {
+		g_debug ("no package list checksum");
+		goto out;
+	}
+
+	/* get the list */
+	ret = g_file_get_contents (PK_SYSTEM_PACKAGE_LIST_FILENAME, &data, &length, NULL);
+	if (!ret) {
+		g_debug ("no package list");
+		goto out;
+	}
+
+	/* has anything else touched it */
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) data, length);
+	if (g_strcmp0 (checksum, checksum_saved) != 0) {
+		g_debug ("package list checksum %s does not match %s", checksum, checksum_saved);
+		goto out;
+	}
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_transaction_extra_list_item_free);
+	if (length == 0)
+		goto out;
+	lines = g_strsplit (data, "\n", -1);
+	for (i=0; lines[i] != NULL; i++) {
+		sections = g_strsplit (lines[i], "\t", 3);
+		if (g_strv_length (sections) != 3) {
+			g_warning ("invalid package list line: %s", lines[i]);
+			g_strfreev (sections);
+			continue;
+		}
+		item = g_new0 (PkTransactionExtraListItem, 1);
+		item->info = pk_info_enum_from_string (sections[0]);
+		item->package_id = g_strdup (sections[1]);
+		item->summary = g_strdup (sections[2]);
+		g_ptr_array_add (items, item);
+		g_strfreev (sections);
+	}
+out:
+	g_strfreev (lines);
+	g_free (checksum);
+	g_free (checksum_saved);
+	g_free (data);
+	return items;
+}
+
+/**
+ * pk_transaction_extra_package_list_index_add:
+ *
+ * Adds the item to the bucket for its name and arch.
+ **/
+static void
+pk_transaction_extra_package_list_index_add (GHashTable *index, PkTransactionExtraListItem *item)
+{
+	gchar *key;
+	gchar **split;
+	GPtrArray *bucket;
+
+	split = pk_package_id_split (item->package_id);
+	if (split == NULL)
+		return;
+	key = g_strdup_printf ("%s;%s", split[PK_PACKAGE_ID_NAME], split[PK_PACKAGE_ID_ARCH]);
+	bucket = g_hash_table_lookup (index, key);
+	if (bucket == NULL) {
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (index, key, bucket);
+	} else {
+		g_free (key);
+	}
+	g_ptr_array_add (bucket, item);
+	g_strfreev (split);
+}
+
+/**
+ * pk_transaction_extra_package_list_index_new:
+ *
+ * Return value: the items grouped by name and arch, so each change only
+ * looks at the lines for that package.
+ **/
+static GHashTable *
+pk_transaction_extra_package_list_index_new (GPtrArray *items)
+{
+	guint i;
+	GHashTable *index;
+
+	index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+	for (i=0; i<items->len; i++)
+		pk_transaction_extra_package_list_index_add (index, g_ptr_array_index (items, i));
+	return index;
+}
+
+/**
+ * pk_transaction_extra_package_list_remove:
+ * @installed: if %TRUE, then only remove installed items, otherwise only
+ * remove the available ones
+ * @same_version: if %FALSE, then only remove different versions
+ *
+ * Marks the items with the same name and arch as removed. Installed and
+ * available items are handled separately, so a removed package goes back to
+ * being available and newer versions stay in the list after an update.
+ **/
+static void
+pk_transaction_extra_package_list_remove (GHashTable *index, gchar **split, gboolean installed, gboolean same_version)
+{
+	guint i;
+	gboolean ret;
+	gchar *key;
+	gchar **split_tmp;
+	GPtrArray *bucket;
+	PkTransactionExtraListItem *item;
+
+	key = g_strdup_printf ("%s;%s", split[PK_PACKAGE_ID_NAME], split[PK_PACKAGE_ID_ARCH]);
+	bucket = g_hash_table_lookup (index, key);
+	g_free (key);
+	if (bucket == NULL)
+		return;
+
+	for (i=0; i<bucket->len; i++) {
+		item = g_ptr_array_index (bucket, i);
+		if (item->removed || (item->info == PK_INFO_ENUM_INSTALLED) != installed)
+			continue;
+		split_tmp = pk_package_id_split (item->package_id);
+		if (split_tmp == NULL)
+			continue;
+		ret = (g_strcmp0 (split[PK_PACKAGE_ID_VERSION], split_tmp[PK_PACKAGE_ID_VERSION]) == 0);
+		if (ret == same_version)
+			item->removed = TRUE;
+		g_strfreev (split_tmp);
+	}
 }
 
 /**
@@ -483,8 +1120,14 @@ gboolean
 pk_transaction_extra_update_package_list (PkTransactionExtra *extra)
 {
 	gboolean ret;
-	gchar *data = NULL;
+	guint i;
+	gchar *package_id;
+	gchar *summary;
+	PkInfoEnum info;
+	PkPackage *package;
+	GPtrArray *items;
 	GError *error = NULL;
+	PkTransactionExtraListItem *item;
 
 	g_return_val_if_fail (PK_IS_POST_TRANS (extra), FALSE);
 
@@ -514,8 +1157,21 @@ pk_transaction_extra_update_package_list (PkTransactionExtra *extra)
 	pk_transaction_extra_set_progress_changed (extra, 90);
 
 	/* convert to a file */
-	data = pk_transaction_extra_package_list_to_string (extra->priv->list);
-	ret = g_file_set_contents (PK_SYSTEM_PACKAGE_LIST_FILENAME, data, -1, &error);
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_transaction_extra_list_item_free);
+	for (i=0; i<extra->priv->list->len; i++) {
+		package = g_ptr_array_index (extra->priv->list, i);
+		g_object_get (package,
+			      "info", &info,
+			      "package-id", &package_id,
+			      "summary", &summary,
+			      NULL);
+		item = g_new0 (PkTransactionExtraListItem, 1);
+		item->info = info;
+		item->package_id = package_id;
+		item->summary = summary;
+		g_ptr_array_add (items, item);
+	}
+	ret = pk_transaction_extra_package_list_save (items, &error);
 	if (!ret) {
 		g_warning ("failed to save to file: %s", error->message);
 		g_error_free (error);
@@ -525,7 +1181,227 @@ pk_transaction_extra_update_package_list (PkTransactionExtra *extra)
 	pk_transaction_extra_set_progress_changed (extra, 100);
 	pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_FINISHED);
 
-	g_free (data);
+	g_ptr_array_unref (items);
+	return ret;
+}
+
+/**
+ * pk_transaction_extra_update_package_list_delta:
+ * @packages: the #PkPackage's emitted by the finished transaction
+ *
+ * Patches the saved package list with what the transaction changed, rather
+ * than doing a full GetPackages. If the saved list is missing or has been
+ * modified then we fall back to regenerating it.
+ **/
+gboolean
+pk_transaction_extra_update_package_list_delta (PkTransactionExtra *extra, GPtrArray *packages)
+{
+	guint i;
+	gboolean ret;
+	gchar **split;
+	gchar *package_id;
+	gchar *summary;
+	PkInfoEnum info;
+	PkPackage *package;
+	GPtrArray *items;
+	GHashTable *index;
+	GError *error = NULL;
+	PkTransactionExtraListItem *item;
+
+	g_return_val_if_fail (PK_IS_POST_TRANS (extra), FALSE);
+	g_return_val_if_fail (packages != NULL, FALSE);
+
+	/* cannot patch, so do it the slow way */
+	items = pk_transaction_extra_package_list_load ();
+	if (items == NULL)
+		return pk_transaction_extra_update_package_list (extra);
+	index = pk_transaction_extra_package_list_index_new (items);
+
+	pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+	pk_transaction_extra_set_progress_changed (extra, 101);
+
+	for (i=0; i<packages->len; i++) {
+		package = g_ptr_array_index (packages, i);
+		g_object_get (package,
+			      "info", &info,
+			      "package-id", &package_id,
+			      "summary", &summary,
+			      NULL);
+		split = pk_package_id_split (package_id);
+		if (split == NULL)
+			goto skip;
+
+		if (info == PK_INFO_ENUM_REMOVING || info == PK_INFO_ENUM_OBSOLETING) {
+			pk_transaction_extra_package_list_remove (index, split, TRUE, TRUE);
+		} else if (info == PK_INFO_ENUM_INSTALLING || info == PK_INFO_ENUM_UPDATING) {
+			/* replace any installed entry, and the old versions when updating */
+			pk_transaction_extra_package_list_remove (index, split, TRUE, TRUE);
+			if (info == PK_INFO_ENUM_UPDATING)
+				pk_transaction_extra_package_list_remove (index, split, TRUE, FALSE);
+
+			/* the same version is no longer available, as it is installed */
+			pk_transaction_extra_package_list_remove (index, split, FALSE, TRUE);
+			item = g_new0 (PkTransactionExtraListItem, 1);
+			item->info = PK_INFO_ENUM_INSTALLED;
+			item->package_id = pk_package_id_build (split[PK_PACKAGE_ID_NAME],
+								split[PK_PACKAGE_ID_VERSION],
+								split[PK_PACKAGE_ID_ARCH],
+								"installed");
+			item->summary = g_strdup (summary);
+			g_ptr_array_add (items, item);
+			pk_transaction_extra_package_list_index_add (index, item);
+		}
+skip:
+		g_strfreev (split);
+		g_free (package_id);
+		g_free (summary);
+	}
+
+	/* save the patched list */
+	ret = pk_transaction_extra_package_list_save (items, &error);
+	if (!ret) {
+		g_warning ("failed to save to file: %s", error->message);
+		g_error_free (error);
+	}
+
+	pk_transaction_extra_set_progress_changed (extra, 100);
+	pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_FINISHED);
+	g_hash_table_unref (index);
+	g_ptr_array_unref (items);
+	return ret;
+}
+
+
+/**
+ * pk_transaction_extra_files_command_index_cb:
+ **/
+static void
+pk_transaction_extra_files_command_index_cb (PkBackend *backend, PkFiles *files, PkTransactionExtra *extra)
+{
+	guint i;
+	guint j;
+	gchar *dirname;
+	gchar *basename;
+	gchar **filenames = NULL;
+	gchar *package_id = NULL;
+	GPtrArray *package_ids;
+	const gchar *prefixes[] = {"/usr/bin", "/usr/sbin", "/bin", "/sbin", NULL};
+
+	/* get data */
+	g_object_get (files,
+		      "package-id", &package_id,
+		      "files", &filenames,
+		      NULL);
+
+	/* only the same directories command-not-found searches */
+	for (i=0; filenames[i] != NULL; i++) {
+		dirname = g_path_get_dirname (filenames[i]);
+		for (j=0; prefixes[j] != NULL; j++) {
+			if (g_strcmp0 (dirname, prefixes[j]) == 0)
+				break;
+		}
+		g_free (dirname);
+		if (prefixes[j] == NULL)
+			continue;
+
+		basename = g_path_get_basename (filenames[i]);
+		package_ids = g_hash_table_lookup (extra->priv->commands, basename);
+		if (package_ids == NULL) {
+			package_ids = g_ptr_array_new_with_free_func (g_free);
+			g_hash_table_insert (extra->priv->commands, basename, package_ids);
+		} else {
+			g_free (basename);
+		}
+
+		/* the same command may be in more than one prefix */
+		for (j=0; j<package_ids->len; j++) {
+			if (g_strcmp0 (g_ptr_array_index (package_ids, j), package_id) == 0)
+				break;
+		}
+		if (j == package_ids->len)
+			g_ptr_array_add (package_ids, g_strdup (package_id));
+	}
+	g_strfreev (filenames);
+	g_free (package_id);
+}
+
+/**
+ * pk_transaction_extra_update_command_index:
+ *
+ * Saves which available packages provide which commands, so that
+ * command-not-found can answer without a round trip to the daemon.
+ **/
+gboolean
+pk_transaction_extra_update_command_index (PkTransactionExtra *extra)
+{
+	gboolean ret = FALSE;
+	guint i;
+	guint signal_files;
+	gchar **package_ids = NULL;
+	GPtrArray *list;
+	PkPackage *package;
+	GError *error = NULL;
+
+	g_return_val_if_fail (PK_IS_POST_TRANS (extra), FALSE);
+
+	if (!pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_GET_PACKAGES) ||
+	    !pk_backend_is_implemented (extra->priv->backend, PK_ROLE_ENUM_GET_FILES)) {
+		g_debug ("cannot get packages or files");
+		return FALSE;
+	}
+
+	g_debug ("updating command index");
+	pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+	pk_transaction_extra_set_progress_changed (extra, 101);
+
+	/* get the same packages command-not-found would search */
+	if (extra->priv->list->len > 0)
+		g_ptr_array_remove_range (extra->priv->list, 0, extra->priv->list->len);
+	pk_backend_reset (extra->priv->backend);
+	pk_backend_get_packages (extra->priv->backend,
+				 pk_bitfield_from_enums (PK_FILTER_ENUM_NOT_INSTALLED,
+							 PK_FILTER_ENUM_NEWEST,
+							 PK_FILTER_ENUM_ARCH, -1));
+
+	/* wait for finished */
+	g_main_loop_run (extra->priv->loop);
+
+	list = g_ptr_array_new_with_free_func (g_free);
+	for (i=0; i<extra->priv->list->len; i++) {
+		package = g_ptr_array_index (extra->priv->list, i);
+		g_ptr_array_add (list, g_strdup (pk_package_get_id (package)));
+	}
+	if (list->len == 0) {
+		g_debug ("no available packages");
+		goto out;
+	}
+	pk_transaction_extra_set_progress_changed (extra, 50);
+
+	/* get all the file lists in one go */
+	g_hash_table_remove_all (extra->priv->commands);
+	signal_files = g_signal_connect (extra->priv->backend, "files",
+					 G_CALLBACK (pk_transaction_extra_files_command_index_cb), extra);
+	package_ids = pk_ptr_array_to_strv (list);
+	pk_backend_reset (extra->priv->backend);
+	pk_backend_get_files (extra->priv->backend, package_ids);
+
+	/* wait for finished */
+	g_main_loop_run (extra->priv->loop);
+	g_signal_handler_disconnect (extra->priv->backend, signal_files);
+
+	/* save */
+	g_debug ("saving %i commands", g_hash_table_size (extra->priv->commands));
+	ret = pk_command_index_save (extra->priv->commands, PK_COMMAND_INDEX_FILENAME, &error);
+	if (!ret) {
+		g_warning ("failed to save command index: %s", error->message);
+		g_error_free (error);
+	}
+	g_hash_table_remove_all (extra->priv->commands);
+out:
+	pk_transaction_extra_set_progress_changed (extra, 100);
+	pk_transaction_extra_set_status_changed (extra, PK_STATUS_ENUM_FINISHED);
+	g_strfreev (package_ids);
+	g_ptr_array_unref (list);
 	return ret;
 }
 
@@ -798,12 +1674,13 @@ pk_transaction_extra_check_library_restart (PkTransactionExtra *extra)
 	gint uid;
 	guint i;
 	guint pid;
-	gchar *filename;
 	gchar *cmdline;
 	gchar *cmdline_full;
+	gchar **filenames;
+	const gchar *package_id;
 	GPtrArray *files_session;
 	GPtrArray *files_system;
-	PkPackage *package;
+	GPtrArray *package_ids;
 	GPtrArray *pids;
 
 	g_return_val_if_fail (PK_IS_POST_TRANS (extra), FALSE);
@@ -855,27 +1732,35 @@ pk_transaction_extra_check_library_restart (PkTransactionExtra *extra)
 	}
 
 	/* process all session restarts */
-	for (i=0; i<files_session->len; i++) {
-		filename = g_ptr_array_index (files_session, i);
-
-		package = pk_transaction_extra_get_installed_package_for_file (extra, filename);
-		if (package == NULL) {
-			g_debug ("failed to find package for %s", filename);
-			continue;
+	if (files_session->len > 0) {
+		filenames = pk_ptr_array_to_strv (files_session);
+		package_ids = pk_transaction_extra_get_installed_package_ids_for_files (extra, filenames);
+		for (i=0; i<files_session->len; i++) {
+			package_id = g_ptr_array_index (package_ids, i);
+			if (package_id == NULL) {
+				g_debug ("failed to find package for %s", filenames[i]);
+				continue;
+			}
+			pk_backend_require_restart (extra->priv->backend, PK_RESTART_ENUM_SECURITY_SESSION, package_id);
 		}
-		pk_backend_require_restart (extra->priv->backend, PK_RESTART_ENUM_SECURITY_SESSION, pk_package_get_id (package));
+		g_ptr_array_unref (package_ids);
+		g_strfreev (filenames);
 	}
 
 	/* process all system restarts */
-	for (i=0; i<files_system->len; i++) {
-		filename = g_ptr_array_index (files_system, i);
-
-		package = pk_transaction_extra_get_installed_package_for_file (extra, filename);
-		if (package == NULL) {
-			g_debug ("failed to find package for %s", filename);
-			continue;
+	if (files_system->len > 0) {
+		filenames = pk_ptr_array_to_strv (files_system);
+		package_ids = pk_transaction_extra_get_installed_package_ids_for_files (extra, filenames);
+		for (i=0; i<files_system->len; i++) {
+			package_id = g_ptr_array_index (package_ids, i);
+			if (package_id == NULL) {
+				g_debug ("failed to find package for %s", filenames[i]);
+				continue;
+			}
+			pk_backend_require_restart (extra->priv->backend, PK_RESTART_ENUM_SECURITY_SYSTEM, package_id);
 		}
-		pk_backend_require_restart (extra->priv->backend, PK_RESTART_ENUM_SECURITY_SYSTEM, pk_package_get_id (package));
+		g_ptr_array_unref (package_ids);
+		g_strfreev (filenames);
 	}
 
 out:
@@ -1138,6 +2023,7 @@ pk_transaction_extra_finalize (GObject *object)
 	g_main_loop_unref (extra->priv->loop);
 	sqlite3_close (extra->priv->db);
 	g_hash_table_unref (extra->priv->hash);
+	g_hash_table_unref (extra->priv->commands);
 	g_ptr_array_unref (extra->priv->files_list);
 	g_strfreev (extra->priv->no_update_process_list);
 
@@ -1145,6 +2031,7 @@ pk_transaction_extra_finalize (GObject *object)
 	g_object_unref (extra->priv->lsof);
 	g_object_unref (extra->priv->proc);
 	g_object_unref (extra->priv->conf);
+	g_object_unref (extra->priv->file_index);
 	g_ptr_array_unref (extra->priv->list);
 
 	G_OBJECT_CLASS (pk_transaction_extra_parent_class)->finalize (object);
@@ -1194,9 +2081,13 @@ pk_transaction_extra_init (PkTransactionExtra *extra)
 	extra->priv->proc = pk_proc_new ();
 	extra->priv->db = NULL;
 	extra->priv->pids = NULL;
-	extra->priv->hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	extra->priv->hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						   (GDestroyNotify) pk_transaction_extra_desktop_item_free);
+	extra->priv->commands = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_ptr_array_unref);
 	extra->priv->files_list = g_ptr_array_new_with_free_func (g_free);
 	extra->priv->conf = pk_conf_new ();
+	extra->priv->file_index = pk_file_index_new ();
 
 	extra->priv->finished_id =
 		g_signal_connect (extra->priv->backend, "finished",
@@ -1227,7 +2118,10 @@ pk_transaction_extra_init (PkTransactionExtra *extra)
 			    "filename TEXT,"
 			    "package TEXT,"
 			    "show INTEGER,"
-			    "md5 TEXT);";
+			    "md5 TEXT,"
+			    "inode INTEGER DEFAULT 0,"
+			    "size INTEGER DEFAULT 0,"
+			    "mtime INTEGER DEFAULT 0);";
 		rc = sqlite3_exec (extra->priv->db, statement, NULL, NULL, &error_msg);
 		if (rc != SQLITE_OK) {
 			g_warning ("SQL error: %s\n", error_msg);
@@ -1235,6 +2129,16 @@ pk_transaction_extra_init (PkTransactionExtra *extra)
 		}
 	}
 
+	/* check cache has the file metadata (since 0.6.11) */
+	rc = sqlite3_exec (extra->priv->db, "SELECT inode, size, mtime FROM cache LIMIT 1", NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_debug ("altering table to repair: %s", error_msg);
+		sqlite3_free (error_msg);
+		sqlite3_exec (extra->priv->db, "ALTER TABLE cache ADD COLUMN inode INTEGER DEFAULT 0;", NULL, NULL, NULL);
+		sqlite3_exec (extra->priv->db, "ALTER TABLE cache ADD COLUMN size INTEGER DEFAULT 0;", NULL, NULL, NULL);
+		sqlite3_exec (extra->priv->db, "ALTER TABLE cache ADD COLUMN mtime INTEGER DEFAULT 0;", NULL, NULL, NULL);
+	}
+
 	/* we don't need to keep syncing */
 	sqlite3_exec (extra->priv->db, "PRAGMA synchronous=OFF", NULL, NULL, NULL);
 }
@@ -51,7 +51,10 @@ PkTransactionExtra	*pk_transaction_extra_new		(void);
 
 gboolean	 pk_transaction_extra_clear_firmware_requests	(PkTransactionExtra	*extra);
 gboolean	 pk_transaction_extra_update_package_list	(PkTransactionExtra	*extra);
+gboolean	 pk_transaction_extra_update_package_list_delta (PkTransactionExtra	*extra,
+								 GPtrArray		*packages);
 gboolean	 pk_transaction_extra_import_desktop_files	(PkTransactionExtra	*extra);
+gboolean	 pk_transaction_extra_update_command_index	(PkTransactionExtra	*extra);
 gboolean	 pk_transaction_extra_check_running_process	(PkTransactionExtra	*extra,
 								 gchar			**package_ids);
 gboolean	 pk_transaction_extra_check_desktop_files	(PkTransactionExtra	*extra,
@@ -59,6 +62,8 @@ gboolean	 pk_transaction_extra_check_desktop_files	(PkTransactionExtra	*extra,
 gboolean	 pk_transaction_extra_check_library_restart	(PkTransactionExtra	*extra);
 gboolean	 pk_transaction_extra_check_library_restart_pre	(PkTransactionExtra	*extra,
 								 gchar			**package_ids);
+gboolean	 pk_transaction_extra_update_file_index	(PkTransactionExtra	*extra,
+								 GPtrArray		*packages);
 gboolean	 pk_transaction_extra_applications_are_running	(PkTransactionExtra	*extra,
 								 gchar			**package_ids,
 								 GError			**error);
@@ -101,6 +101,7 @@ struct PkTransactionPrivate
 	gboolean		 caller_active;
 	PkHintEnum		 background;
 	PkHintEnum		 interactive;
+	gboolean		 supports_file_list;
 	gchar			*locale;
 	gchar			*frontend_socket;
 	guint			 cache_age;
@@ -148,6 +149,9 @@ struct PkTransactionPrivate
 	gchar			*cached_directory;
 	gchar			*cached_cat_id;
 	PkProvidesEnum		 cached_provides;
+	gchar			**cached_roles;
+	guint			 batch_index;
+	guint			 batch_id;
 
 	guint			 signal_allow_cancel;
 	guint			 signal_details;
@@ -174,6 +178,7 @@ enum {
 	SIGNAL_ERROR_CODE,
 	SIGNAL_DISTRO_UPGRADE,
 	SIGNAL_FILES,
+	SIGNAL_FILE_LIST,
 	SIGNAL_FINISHED,
 	SIGNAL_MESSAGE,
 	SIGNAL_PACKAGE,
@@ -566,10 +571,18 @@ pk_transaction_files_cb (PkBackend *backend, PkFiles *item, PkTransaction *trans
 	/* add to results */
 	pk_results_add_files (transaction->priv->results, item);
 
+	/* send the array as-is if the client can take it */
+	if (transaction->priv->supports_file_list) {
+		g_debug ("emitting file-list %s, %i files", package_id, g_strv_length (files));
+		g_signal_emit (transaction, signals[SIGNAL_FILE_LIST], 0, package_id, files);
+		goto out;
+	}
+
 	/* emit */
 	filelist = g_strjoinv (";", files);
 	g_debug ("emitting files %s, %s", package_id, filelist);
 	g_signal_emit (transaction, signals[SIGNAL_FILES], 0, package_id, filelist);
+out:
 	g_free (filelist);
 	g_free (package_id);
 	g_strfreev (files);
@@ -851,6 +864,171 @@ pk_transaction_get_state (PkTransaction *transaction)
 	return transaction->priv->state;
 }
 
+/**
+ * pk_transaction_role_keeps_results:
+ *
+ * Return value: %TRUE if the results are needed after the transaction has finished
+ **/
+static gboolean
+pk_transaction_role_keeps_results (PkRoleEnum role)
+{
+	/* copied into the updates cache */
+	if (role == PK_ROLE_ENUM_GET_UPDATES)
+		return TRUE;
+
+	/* resolved packages are used for the rest of the batch */
+	if (role == PK_ROLE_ENUM_BATCH)
+		return TRUE;
+
+	/* logged, and used to update the desktop files and file index */
+	if (role == PK_ROLE_ENUM_UPDATE_SYSTEM ||
+	    role == PK_ROLE_ENUM_UPDATE_PACKAGES ||
+	    role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
+	    role == PK_ROLE_ENUM_INSTALL_FILES ||
+	    role == PK_ROLE_ENUM_REMOVE_PACKAGES)
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * pk_transaction_results_item_cb:
+ **/
+static void
+pk_transaction_results_item_cb (PkResults *results, GObject *item, PkTransaction *transaction)
+{
+	/* already emitted on the bus and never read back, so don't keep
+	 * a copy of every package or file list in the daemon */
+}
+
+/**
+ * pk_transaction_batch_has_next:
+ **/
+static gboolean
+pk_transaction_batch_has_next (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	if (priv->role != PK_ROLE_ENUM_BATCH)
+		return FALSE;
+	return (priv->cached_roles[priv->batch_index + 1] != NULL);
+}
+
+/**
+ * pk_transaction_batch_get_role:
+ **/
+static PkRoleEnum
+pk_transaction_batch_get_role (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	return pk_role_enum_from_string (priv->cached_roles[priv->batch_index]);
+}
+
+/**
+ * pk_transaction_batch_run:
+ *
+ * Runs the current query of the batch on the backend.
+ **/
+static void
+pk_transaction_batch_run (PkTransaction *transaction)
+{
+	PkRoleEnum role;
+	PkTransactionPrivate *priv = transaction->priv;
+
+	role = pk_transaction_batch_get_role (transaction);
+	g_debug ("running batch query %i: %s", priv->batch_index, pk_role_enum_to_string (role));
+	if (role == PK_ROLE_ENUM_RESOLVE)
+		pk_backend_resolve (priv->backend, priv->cached_filters, priv->cached_package_ids);
+	else if (role == PK_ROLE_ENUM_GET_DETAILS)
+		pk_backend_get_details (priv->backend, priv->cached_package_ids);
+	else if (role == PK_ROLE_ENUM_GET_UPDATE_DETAIL)
+		pk_backend_get_update_detail (priv->backend, priv->cached_package_ids);
+	else if (role == PK_ROLE_ENUM_GET_FILES)
+		pk_backend_get_files (priv->backend, priv->cached_package_ids);
+	else {
+		/* pk_transaction_batch_check_roles should have stopped this */
+		g_warning ("role %s cannot be batched", pk_role_enum_to_string (role));
+		pk_backend_error_code (priv->backend, PK_ERROR_ENUM_INTERNAL_ERROR,
+				       "Role %s cannot be batched", pk_role_enum_to_string (role));
+		pk_backend_finished (priv->backend);
+	}
+}
+
+/**
+ * pk_transaction_batch_next_cb:
+ **/
+static gboolean
+pk_transaction_batch_next_cb (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	/* we still hold the backend, so just prepare it for the next query */
+	priv->batch_id = 0;
+	pk_backend_reset (priv->backend);
+	pk_backend_set_role (priv->backend, pk_transaction_batch_get_role (transaction));
+	pk_backend_set_percentage (priv->backend, PK_BACKEND_PERCENTAGE_INVALID);
+	pk_transaction_batch_run (transaction);
+	return FALSE;
+}
+
+/**
+ * pk_transaction_batch_prepare_next:
+ *
+ * Return value: %TRUE if there is another query in the batch to run
+ **/
+static gboolean
+pk_transaction_batch_prepare_next (PkTransaction *transaction)
+{
+	guint i;
+	gchar **package_ids;
+	GPtrArray *array;
+	PkPackage *item;
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (!pk_transaction_batch_has_next (transaction))
+		return FALSE;
+
+	/* the rest of the batch works on the packages we just resolved */
+	if (pk_transaction_batch_get_role (transaction) == PK_ROLE_ENUM_RESOLVE) {
+		array = pk_results_get_package_array (priv->results);
+		if (array->len == 0) {
+			g_debug ("nothing resolved, so skipping rest of batch");
+			g_ptr_array_unref (array);
+			return FALSE;
+		}
+		package_ids = g_new0 (gchar *, array->len + 1);
+		for (i=0; i<array->len; i++) {
+			item = g_ptr_array_index (array, i);
+			g_object_get (item,
+				      "package-id", &package_ids[i],
+				      NULL);
+		}
+		g_strfreev (priv->cached_package_ids);
+		priv->cached_package_ids = package_ids;
+		g_ptr_array_unref (array);
+	}
+
+	/* nothing after the first query is needed again */
+	pk_results_set_item_callback (priv->results,
+				      (PkResultsItemCallback) pk_transaction_results_item_cb,
+				      transaction);
+
+	priv->batch_index++;
+	return TRUE;
+}
+
+/**
+ * pk_transaction_get_duration_items:
+ *
+ * Return value: the number of packages the duration of this transaction
+ * depends on, or 1 if it is not for any packages
+ **/
+static guint
+pk_transaction_get_duration_items (PkTransaction *transaction)
+{
+	if (transaction->priv->cached_package_ids == NULL)
+		return 1;
+	return MAX (g_strv_length (transaction->priv->cached_package_ids), 1);
+}
+
 /**
  * pk_transaction_finished_cb:
  **/
@@ -868,6 +1046,7 @@ pk_transaction_finished_cb (PkBackend *backend, PkExitEnum exit_enum, PkTransact
 	gchar *package_id;
 	gchar *package_id_tmp;
 	gchar **split;
+	gchar *backend_name;
 	PkInfoEnum info;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
@@ -879,6 +1058,19 @@ pk_transaction_finished_cb (PkBackend *backend, PkExitEnum exit_enum, PkTransact
 		return;
 	}
 
+	/* run the next query of a batch in this transaction, but not from
+	 * inside the backend ::finished emission as we reset the backend */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    pk_transaction_batch_prepare_next (transaction)) {
+		transaction->priv->batch_id = g_idle_add ((GSourceFunc) pk_transaction_batch_next_cb, transaction);
+		return;
+	}
+
+	/* the batch is over, either after the last query or because it
+	 * stopped early, so send the status we held back from the backend */
+	if (transaction->priv->role == PK_ROLE_ENUM_BATCH)
+		pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_FINISHED);
+
 	/* disconnect these straight away, as the PkTransaction object takes time to timeout */
 	g_signal_handler_disconnect (transaction->priv->backend, transaction->priv->signal_details);
 	g_signal_handler_disconnect (transaction->priv->backend, transaction->priv->signal_error_code);
@@ -992,6 +1184,23 @@ pk_transaction_finished_cb (PkBackend *backend, PkExitEnum exit_enum, PkTransact
 		}
 	}
 
+	/* keep the installed file index and package list in sync with what we just changed */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    (transaction->priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
+	     transaction->priv->role == PK_ROLE_ENUM_INSTALL_FILES ||
+	     transaction->priv->role == PK_ROLE_ENUM_REMOVE_PACKAGES ||
+	     transaction->priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES ||
+	     transaction->priv->role == PK_ROLE_ENUM_UPDATE_SYSTEM)) {
+		array = pk_results_get_package_array (transaction->priv->results);
+		pk_transaction_extra_update_file_index (transaction->priv->transaction_extra, array);
+
+		/* patch the package list rather than regenerating it */
+		ret = pk_conf_get_bool (transaction->priv->conf, "UpdatePackageList");
+		if (ret)
+			pk_transaction_extra_update_package_list_delta (transaction->priv->transaction_extra, array);
+		g_ptr_array_unref (array);
+	}
+
 	/* signals we are not allowed to send from the second phase post transaction */
 	g_signal_handler_disconnect (transaction->priv->backend, transaction->priv->signal_allow_cancel);
 	g_signal_handler_disconnect (transaction->priv->backend, transaction->priv->signal_message);
@@ -1013,6 +1222,11 @@ pk_transaction_finished_cb (PkBackend *backend, PkExitEnum exit_enum, PkTransact
 		if (ret)
 			pk_transaction_extra_import_desktop_files (transaction->priv->transaction_extra);
 
+		/* generate the command-not-found index */
+		ret = pk_conf_get_bool (transaction->priv->conf, "UpdateCommandIndex");
+		if (ret)
+			pk_transaction_extra_update_command_index (transaction->priv->transaction_extra);
+
 		/* clear the firmware requests directory */
 		pk_transaction_extra_clear_firmware_requests (transaction->priv->transaction_extra);
 	}
@@ -1093,6 +1307,15 @@ pk_transaction_finished_cb (PkBackend *backend, PkExitEnum exit_enum, PkTransact
 	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
 		pk_transaction_db_action_time_reset (transaction->priv->transaction_db, transaction->priv->role);
 
+	/* remember how long this took to estimate the next one */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS) {
+		backend_name = pk_backend_get_name (transaction->priv->backend);
+		if (backend_name != NULL)
+			pk_transaction_db_add_duration (transaction->priv->transaction_db, transaction->priv->role,
+							backend_name, pk_transaction_get_duration_items (transaction), time_ms);
+		g_free (backend_name);
+	}
+
 	/* did we finish okay? */
 	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
 		pk_transaction_db_set_finished (transaction->priv->transaction_db, transaction->priv->tid, TRUE, time_ms);
@@ -1477,6 +1700,13 @@ pk_transaction_status_changed_cb (PkBackend *backend, PkStatusEnum status, PkTra
 	if (status == PK_STATUS_ENUM_WAIT)
 		return;
 
+	/* the backend finishes each query of a batch, but we only know if the
+	 * batch goes on when the query has finished, so this is sent from
+	 * pk_transaction_finished_cb instead */
+	if (status == PK_STATUS_ENUM_FINISHED &&
+	    transaction->priv->role == PK_ROLE_ENUM_BATCH)
+		return;
+
 	/* have we already been marked as finished? */
 	if (transaction->priv->finished) {
 		g_warning ("Already finished, so can't proxy status %s", pk_status_enum_to_string (status));
@@ -1802,6 +2032,7 @@ pk_transaction_set_running (PkTransaction *transaction)
 {
 	gboolean ret;
 	guint i;
+	gchar *backend_name;
 	GError *error = NULL;
 	PkBitfield filters;
 	PkTransactionPrivate *priv = PK_TRANSACTION_GET_PRIVATE (transaction);
@@ -1863,10 +2094,27 @@ pk_transaction_set_running (PkTransaction *transaction)
 	/* might have to reset again if we used the backend */
 	pk_backend_reset (priv->backend);
 
-	/* set the role */
-	pk_backend_set_role (priv->backend, priv->role);
+	/* only keep what we have to */
+	if (!pk_transaction_role_keeps_results (priv->role))
+		pk_results_set_item_callback (priv->results,
+					      (PkResultsItemCallback) pk_transaction_results_item_cb,
+					      transaction);
+
+	/* set the role, which for a batch is the role of the first query */
+	if (priv->role == PK_ROLE_ENUM_BATCH)
+		pk_backend_set_role (priv->backend, pk_transaction_batch_get_role (transaction));
+	else
+		pk_backend_set_role (priv->backend, priv->role);
 	g_debug ("setting role for %s to %s", priv->tid, pk_role_enum_to_string (priv->role));
 
+	/* estimate the time remaining from what this took before */
+	backend_name = pk_backend_get_name (priv->backend);
+	if (backend_name != NULL)
+		pk_backend_set_expected_runtime (priv->backend,
+						 pk_transaction_db_get_duration (priv->transaction_db, priv->role,
+										 backend_name, pk_transaction_get_duration_items (transaction)));
+	g_free (backend_name);
+
 	/* connect up the signals */
 	priv->signal_allow_cancel =
 		g_signal_connect (priv->backend, "allow-cancel",
@@ -1988,6 +2236,8 @@ pk_transaction_set_running (PkTransaction *transaction)
 		pk_backend_repo_set_data (priv->backend, priv->cached_repo_id, priv->cached_parameter, priv->cached_value);
 	else if (priv->role == PK_ROLE_ENUM_SIMULATE_INSTALL_FILES)
 		pk_backend_simulate_install_files (priv->backend, priv->cached_full_paths);
+	else if (priv->role == PK_ROLE_ENUM_BATCH)
+		pk_transaction_batch_run (transaction);
 	else if (priv->role == PK_ROLE_ENUM_SIMULATE_INSTALL_PACKAGES) {
 		/* fallback to a method we do have */
 		if (pk_backend_is_implemented (priv->backend, PK_ROLE_ENUM_SIMULATE_INSTALL_PACKAGES)) {
@@ -2724,6 +2974,169 @@ pk_transaction_accept_eula (PkTransaction *transaction, const gchar *eula_id, DB
 	pk_transaction_dbus_return (context);
 }
 
+/**
+ * pk_transaction_batch_check_roles:
+ **/
+static gboolean
+pk_transaction_batch_check_roles (PkTransaction *transaction, gchar **roles, GError **error)
+{
+	guint i;
+	PkRoleEnum role;
+	PkBitfield seen = 0;
+	gboolean ret = FALSE;
+
+	/* nothing to do */
+	if (roles == NULL || roles[0] == NULL) {
+		g_set_error (error, PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_INPUT_INVALID,
+			     "No roles to run");
+		goto out;
+	}
+
+	for (i=0; roles[i] != NULL; i++) {
+		role = pk_role_enum_from_string (roles[i]);
+
+		/* only the read-only queries with their own result types */
+		if (role != PK_ROLE_ENUM_RESOLVE &&
+		    role != PK_ROLE_ENUM_GET_DETAILS &&
+		    role != PK_ROLE_ENUM_GET_UPDATE_DETAIL &&
+		    role != PK_ROLE_ENUM_GET_FILES) {
+			g_set_error (error, PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_INPUT_INVALID,
+				     "Role '%s' cannot be batched", roles[i]);
+			goto out;
+		}
+
+		/* resolve produces the package IDs for the others */
+		if (role == PK_ROLE_ENUM_RESOLVE && i != 0) {
+			g_set_error (error, PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_INPUT_INVALID,
+				     "Resolve has to be the first role in the batch");
+			goto out;
+		}
+		if (pk_bitfield_contain (seen, role)) {
+			g_set_error (error, PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_INPUT_INVALID,
+				     "Role '%s' is already in the batch", roles[i]);
+			goto out;
+		}
+		pk_bitfield_add (seen, role);
+
+		/* not implemented yet */
+		if (!pk_backend_is_implemented (transaction->priv->backend, role)) {
+			g_set_error (error, PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				     "%s not yet supported by backend", roles[i]);
+			goto out;
+		}
+	}
+
+	/* success */
+	ret = TRUE;
+out:
+	return ret;
+}
+
+/**
+ * pk_transaction_batch:
+ **/
+void
+pk_transaction_batch (PkTransaction *transaction, const gchar *filter, gchar **roles,
+		      gchar **packages, DBusGMethodInvocation *context)
+{
+	gboolean ret;
+	GError *error = NULL;
+	gchar *packages_temp;
+	gchar *roles_temp;
+	guint i;
+	guint length;
+	guint max_length;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	packages_temp = pk_package_ids_to_string (packages);
+	roles_temp = g_strjoinv (";", roles);
+	g_debug ("Batch method called: %s, %s, %s", filter, roles_temp, packages_temp);
+	g_free (packages_temp);
+	g_free (roles_temp);
+
+	/* check the roles are supported and make sense together */
+	ret = pk_transaction_batch_check_roles (transaction, roles, &error);
+	if (!ret) {
+		pk_transaction_release_tid (transaction);
+		pk_transaction_dbus_return_error (context, error);
+		return;
+	}
+
+	/* check if the sender is the same */
+	ret = pk_transaction_verify_sender (transaction, context, &error);
+	if (!ret) {
+		/* don't release tid */
+		pk_transaction_dbus_return_error (context, error);
+		return;
+	}
+
+	/* check the filter */
+	ret = pk_transaction_filter_check (filter, &error);
+	if (!ret) {
+		pk_transaction_release_tid (transaction);
+		pk_transaction_dbus_return_error (context, error);
+		return;
+	}
+
+	/* check for length sanity */
+	length = g_strv_length (packages);
+	if (pk_role_enum_from_string (roles[0]) == PK_ROLE_ENUM_RESOLVE)
+		max_length = pk_conf_get_int (transaction->priv->conf, "MaximumItemsToResolve");
+	else
+		max_length = pk_conf_get_int (transaction->priv->conf, "MaximumPackagesToProcess");
+	if (length > max_length) {
+		error = g_error_new (PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_INPUT_INVALID,
+				     "Too many items to process (%i/%i)", length, max_length);
+		pk_transaction_release_tid (transaction);
+		pk_transaction_dbus_return_error (context, error);
+		return;
+	}
+
+	/* check each package name or package_id for sanity */
+	if (pk_role_enum_from_string (roles[0]) == PK_ROLE_ENUM_RESOLVE) {
+		for (i=0; i<length; i++) {
+			ret = pk_transaction_strvalidate (packages[i], &error);
+			if (!ret) {
+				pk_transaction_release_tid (transaction);
+				pk_transaction_dbus_return_error (context, error);
+				return;
+			}
+		}
+	} else {
+		ret = pk_package_ids_check (packages);
+		if (!ret) {
+			packages_temp = pk_package_ids_to_string (packages);
+			error = g_error_new (PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_PACKAGE_ID_INVALID,
+					     "The package id's '%s' are not valid", packages_temp);
+			g_free (packages_temp);
+			pk_transaction_release_tid (transaction);
+			pk_transaction_dbus_return_error (context, error);
+			return;
+		}
+	}
+
+	/* save so we can run later */
+	transaction->priv->cached_roles = g_strdupv (roles);
+	transaction->priv->cached_package_ids = g_strdupv (packages);
+	transaction->priv->cached_filters = pk_filter_bitfield_from_string (filter);
+	pk_transaction_set_role (transaction, PK_ROLE_ENUM_BATCH);
+
+	/* try to commit this */
+	ret = pk_transaction_commit (transaction);
+	if (!ret) {
+		error = g_error_new (PK_TRANSACTION_ERROR, PK_TRANSACTION_ERROR_COMMIT_FAILED,
+				     "Could not commit to a transaction object");
+		pk_transaction_release_tid (transaction);
+		pk_transaction_dbus_return_error (context, error);
+		return;
+	}
+
+	/* return from async with success */
+	pk_transaction_dbus_return (context);
+}
+
 /**
  * pk_transaction_cancel:
  **/
@@ -2822,6 +3235,17 @@ skip_uid:
 		goto out;
 	}
 
+	/* we're between the queries of a batch, so just don't start the next one */
+	if (transaction->priv->batch_id != 0) {
+		g_source_remove (transaction->priv->batch_id);
+		transaction->priv->batch_id = 0;
+		pk_transaction_finished_cb (transaction->priv->backend, PK_EXIT_ENUM_CANCELLED, transaction);
+
+		/* return from async with success */
+		pk_transaction_dbus_return (context);
+		goto out;
+	}
+
 	/* set the state, as cancelling might take a few seconds */
 	pk_backend_set_status (transaction->priv->backend, PK_STATUS_ENUM_CANCEL);
 
@@ -4797,6 +5221,12 @@ pk_transaction_set_hint (PkTransaction *transaction, const gchar *key, const gch
 		goto out;
 	}
 
+	/* supports-file-list=true */
+	if (g_strcmp0 (key, "supports-file-list") == 0) {
+		priv->supports_file_list = (pk_hint_enum_from_string (value) == PK_HINT_ENUM_TRUE);
+		goto out;
+	}
+
 	/* cache-age=<time-in-seconds> */
 	if (g_strcmp0 (key, "cache-age") == 0) {
 		ret = egg_strtouint (value, &priv->cache_age);
@@ -5600,6 +6030,11 @@ pk_transaction_class_init (PkTransactionClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, pk_marshal_VOID__STRING_STRING,
 			      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRING);
+	signals[SIGNAL_FILE_LIST] =
+		g_signal_new ("file-list",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, pk_marshal_VOID__STRING_BOXED,
+			      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRV);
 	signals[SIGNAL_CATEGORY] =
 		g_signal_new ("category",
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
@@ -5717,6 +6152,7 @@ pk_transaction_init (PkTransaction *transaction)
 	transaction->priv->locale = NULL;
 	transaction->priv->frontend_socket = NULL;
 	transaction->priv->cache_age = 0;
+	transaction->priv->supports_file_list = FALSE;
 #ifdef USE_SECURITY_POLKIT
 	transaction->priv->subject = NULL;
 #endif
@@ -5783,6 +6219,12 @@ pk_transaction_dispose (GObject *object)
 	/* remove any inhibit, it's okay to call this function when it's not needed */
 	pk_inhibit_remove (transaction->priv->inhibit, transaction);
 
+	/* don't run the rest of a batch */
+	if (transaction->priv->batch_id != 0) {
+		g_source_remove (transaction->priv->batch_id);
+		transaction->priv->batch_id = 0;
+	}
+
 	/* were we waiting for the client to authorise */
 	if (transaction->priv->waiting_for_auth) {
 #ifdef USE_SECURITY_POLKIT
@@ -5825,6 +6267,7 @@ pk_transaction_finalize (GObject *object)
 	g_free (transaction->priv->cached_transaction_id);
 	g_free (transaction->priv->cached_directory);
 	g_strfreev (transaction->priv->cached_values);
+	g_strfreev (transaction->priv->cached_roles);
 	g_free (transaction->priv->cached_repo_id);
 	g_free (transaction->priv->cached_parameter);
 	g_free (transaction->priv->cached_value);
@@ -115,6 +115,11 @@ gboolean	 pk_transaction_set_sender			(PkTransaction	*transaction,
 void		 pk_transaction_accept_eula			(PkTransaction	*transaction,
 								 const gchar	*eula_id,
 								 DBusGMethodInvocation *context);
+void		 pk_transaction_batch				(PkTransaction	*transaction,
+								 const gchar	*filter,
+								 gchar		**roles,
+								 gchar		**packages,
+								 DBusGMethodInvocation *context);
 void		 pk_transaction_cancel				(PkTransaction	*transaction,
 								 DBusGMethodInvocation *context);
 void		 pk_transaction_download_packages		(PkTransaction  *transaction,